@@ -1,69 +1,104 @@
 import matplotlib.pyplot as plt
 import random
-from operator import methodcaller
-from operator import itemgetter
+import re
+import struct
 import sys
 import matplotlib.colors as mcolors
 
 if len(sys.argv) < 3:
-	print("Pass input and output file name as command line argument")
+	print("Pass input and output file name as command line argument (and the telemetry file, optional)")
 	exit(-1)
 
 inputFilename = str(sys.argv[1])
 outputFilename = str(sys.argv[2])
-file = open(inputFilename, "r") 
+telemetryFilename = str(sys.argv[3]) if len(sys.argv) > 3 else None
+file = open(inputFilename, "r")
 lines = file.readlines()
 
 nodes = int(lines[0])
 
-gen_num = []
-gen_gnome = []
-for i in range(nodes):
-	gen_gnome.append([])
-
-for line in lines[1:-nodes-2]:
-	num_node = int(line.split()[0].split("-")[0])
-	if num_node == 0:
-		gen = int(line.split()[0].split("-")[1])
-		gen_num.append(gen)
-	gen_fitness = float(line.split()[1])
-	gen_gnome[num_node].append(gen_fitness)
-
-
-time_sol = lines[-nodes-2:]
-time_sol.sort()
-
-solutions = time_sol[:2]
-opt_sol = float(solutions[0].split()[1])
-subopt_sol = float(solutions[1].split()[1])
-
-times = list(map(int,map(itemgetter(1),map(methodcaller("split", "          "),time_sol[2:]))))
+# Lines are told apart by their first field, so any log level (--log) and extra lines can be parsed
+gen_num = [[] for i in range(nodes)]
+gen_gnome = [[] for i in range(nodes)]
+times = [0] * nodes
+opt_sol = subopt_sol = None
+for line in lines[1:]:
+	fields = line.split()
+	if len(fields) != 2:
+		continue
+	key, value = fields
+	if key == "OPT":
+		opt_sol = float(value)
+	elif key == "SUBOPT":
+		subopt_sol = float(value)
+	elif re.fullmatch(r"T-\d+-", key):
+		times[int(key.split("-")[1])] = int(value)
+	elif re.fullmatch(r"\d+-\d+", key):
+		num_node, gen = map(int, key.split("-"))
+		gen_num[num_node].append(gen)
+		gen_gnome[num_node].append(float(value))
+
+# Records of the telemetry (--telemetry), CSV or binary stream
+diversity = None
+if telemetryFilename:
+	records = []
+	if telemetryFilename.endswith(".bin"):
+		data = open(telemetryFilename, "rb").read()
+		magic, version, size = struct.unpack("<III", data[:12])
+		for at in range(12, len(data) - size + 1, size):
+			records.append(struct.unpack("<iiqffffq", data[at:at + struct.calcsize("<iiqffffq")]))
+	else:
+		for line in open(telemetryFilename).readlines()[1:]:
+			fields = line.split(",")
+			records.append((int(fields[0]), int(fields[1]), int(fields[2]), float(fields[3]), float(fields[4]), float(fields[5]), float(fields[6]), int(fields[7])))
+
+	gen_num = [[] for i in range(nodes)]
+	gen_gnome = [[] for i in range(nodes)]
+	diversity = [[] for i in range(nodes)]
+	for rank, gen, time, best, mean, div, offspring_rate, bytes_sent in sorted(records, key=lambda r: (r[0], r[1])):
+		gen_num[rank].append(gen)
+		gen_gnome[rank].append(best)
+		diversity[rank].append(div)
 
 color = ['green', 'red', 'blue', 'black', 'orange', 'gold', 'lime', 'turquoise', 'navy', 'pink', 'purple', 'violet', 'sage', 'linen', 'azure', 'crimson' ]
 #color = list(mcolors.CSS4_COLORS)
 #random.shuffle(color)
 
+if diversity:
+	figure, (fitness_axes, diversity_axes) = plt.subplots(2, 1, sharex=True, gridspec_kw={'height_ratios': [3, 1]})
+else:
+	figure, fitness_axes = plt.subplots()
+
 legendList = []
 # plotting the points
 for index, gen_node in enumerate(gen_gnome):
-	plt.plot(gen_num, gen_node, color=color[index], linewidth = 1, marker='.', markerfacecolor=color[index], markersize=2)
+	fitness_axes.plot(gen_num[index], gen_node, color=color[index], linewidth = 1, marker='.', markerfacecolor=color[index], markersize=2)
 	exectime = times[index]/1000000
 	legendList.append("node " + str(index) + f": {exectime:.2f} s" )
 
-plt.plot(gen_num[-1], opt_sol, color='yellow',marker='*', markersize=10, markeredgecolor='black')
-legendList.append("opt. sol.:"+ str(opt_sol))
+last_gen = max(max(gens) for gens in gen_num if gens)
+if opt_sol is not None:
+	fitness_axes.plot(last_gen, opt_sol, color='yellow',marker='*', markersize=10, markeredgecolor='black')
+	legendList.append("opt. sol.:"+ str(opt_sol))
 
-plt.plot(gen_num[-1], subopt_sol, color='pink',marker='X', markersize=10, markeredgecolor='black')
-legendList.append("found sol.:"+ str(subopt_sol))
+if subopt_sol is not None:
+	fitness_axes.plot(last_gen, subopt_sol, color='pink',marker='X', markersize=10, markeredgecolor='black')
+	legendList.append("found sol.:"+ str(subopt_sol))
 
-plt.legend(legendList)
+fitness_axes.legend(legendList)
 
-# naming the x axis
-plt.ylabel('Fitness')
 # naming the y axis
-plt.xlabel('Generation number')
+fitness_axes.set_ylabel('Fitness')
+
+if diversity:
+	for index, div_node in enumerate(diversity):
+		diversity_axes.plot(gen_num[index], div_node, color=color[index], linewidth = 1)
+	diversity_axes.set_ylabel('Diversity')
+	diversity_axes.set_xlabel('Generation number')
+else:
+	# naming the x axis
+	fitness_axes.set_xlabel('Generation number')
 
 # function to show the plot
 # plt.show()
 plt.savefig(outputFilename)
- 
\ No newline at end of file
@@ -0,0 +1,253 @@
+/**
+ * @file batch.cpp
+ * @author Javier Vela
+ * @brief Source file of the batch mode, the problems of a collection solved by all nodes and threads
+ * @version 0.1
+ * @date 2022-01-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <numeric>
+#include <algorithm>
+#include <omp.h>
+#include "batch.h"
+#include "cache.h"
+#include "genetic.h"
+#include "heldkarp.h"
+#include "mpi.h"
+
+using namespace std;
+using namespace std::chrono;
+
+/**
+ * @brief Read the problems of a collection, one name (without .tsp) per line
+ *
+ * @param collection collection file (benchmarks/collections)
+ * @return names of the problems, in the order of the file
+ */
+vector<string> readCollection(const string &collection)
+{
+	ifstream file(collection);
+	if (!file)
+	{
+		cout << "Error : Collection file (" << collection << ") not found" << endl;
+		exit(-1);
+	}
+
+	vector<string> names;
+	string line;
+	while (getline(file, line))
+	{
+		line = trim(line);
+		if (line != "")
+			names.push_back(line);
+	}
+	return names;
+}
+
+/**
+ * @brief Size in bytes of the file of a problem, an estimate of its work (0 if it can not be opened)
+ */
+static long long problem_size(const string &name)
+{
+	ifstream file(name + ".tsp", ios::binary | ios::ate);
+	return file ? (long long)file.tellg() : 0;
+}
+
+/**
+ * @brief Solve one problem of the collection and return its result
+ */
+static BatchResult solve_problem(const vector<string> &names, int instance, Options &options, MPI_Comm comm, int mpi_rank, int worker, ostream &oss, GeneticBuffers &buffers)
+{
+	// The cache written by prepare already has the distances, neighbours and optimal cost of the problem
+	Map tsp;
+	bool cached = readCache(names[instance], tsp);
+	if (!cached)
+		tsp = readProblem(names[instance] + ".tsp");
+
+	float best_fitness_sol;
+	microseconds execution_time;
+	if (tsp.dimension <= options.EXACT)
+		HeldKarp(tsp, options, comm, 0, oss, best_fitness_sol, execution_time);
+	else
+		GenAlg(tsp, options, comm, 0, oss, best_fitness_sol, execution_time, buffers);
+
+	if (!cached)
+		readSolution(names[instance], tsp);
+
+	BatchResult result;
+	result.instance = instance;
+	result.dimension = tsp.dimension;
+	result.best = best_fitness_sol;
+	result.optimal = tsp.optimalCost;
+	result.time = execution_time.count();
+	result.rank = mpi_rank;
+	result.worker = worker;
+	closeCache(tsp);
+	return result;
+}
+
+/**
+ * @brief Print the results of the collection, in its order, with the gap of every problem to its optimum
+ */
+static void print_results(const vector<string> &names, vector<BatchResult> &results, ostream &oss)
+{
+	sort(results.begin(), results.end(), [](const BatchResult &a, const BatchResult &b) { return a.instance < b.instance; });
+
+	int width = 8;
+	for (const string &name : names)
+		width = max(width, (int)name.size() + 2);
+
+	oss << left << setw(width) << "Instance" << right << setw(8) << "Cities" << setw(14) << "Best" << setw(14) << "Optimum"
+		<< setw(10) << "Gap %" << setw(12) << "Time ms" << setw(6) << "Node" << setw(8) << "Thread" << "\n";
+
+	double gap_sum = 0;
+	int gaps = 0;
+	for (const BatchResult &r : results)
+	{
+		oss << left << setw(width) << names[r.instance] << right << setw(8) << r.dimension << fixed << setprecision(1)
+			<< setw(14) << r.best << setw(14) << r.optimal << setprecision(2);
+		if (r.optimal > 0)
+		{
+			double gap = 100.0 * (r.best - r.optimal) / r.optimal;
+			gap_sum += gap;
+			gaps++;
+			oss << setw(10) << gap;
+		}
+		else
+			oss << setw(10) << "-";
+		oss << setw(12) << r.time / 1000.0 << setw(6) << r.rank << setw(8) << r.worker << defaultfloat << "\n";
+	}
+
+	oss << "Mean gap % : ";
+	if (gaps > 0)
+		oss << fixed << setprecision(2) << gap_sum / gaps << defaultfloat;
+	else
+		oss << "-";
+	oss << endl;
+}
+
+/**
+ * @brief Solve every problem of a collection with the Genetic Algorithm, collective over all nodes
+ *
+ * Each problem is solved by a single worker, a node or, if MPI has MPI_THREAD_MULTIPLE, a thread of a node. Workers
+ * take the next problem from a counter in a window of root as soon as they finish the previous one, biggest problems
+ * first, so the small ones fill the gaps at the end instead of waiting behind a big one. Every worker keeps its
+ * populations and scratch memory from one problem to the next.
+ *
+ * All problems use the same seed, so the result of a problem does not depend on the worker that solved it (with a
+ * single thread per worker).
+ *
+ * Root prints the table of results to <oss> and the throughput to cerr.
+ *
+ * @param collection collection file, one problem per line
+ * @param options parameters of the algorithm, the same for every problem
+ * @param mpi_rank MPI rank of current node
+ * @param mpi_size MPI size
+ * @param mpi_root MPI rank of the root node
+ * @param concurrent solve one problem per thread (MPI_THREAD_MULTIPLE) instead of one per node
+ * @param oss output stream
+ */
+void GenAlgBatch(const string &collection, Options &options, int mpi_rank, int mpi_size, int mpi_root, bool concurrent, ostream &oss)
+{
+	vector<string> names = readCollection(collection);
+	int count = names.size();
+	if (count == 0)
+	{
+		if (mpi_rank == mpi_root)
+			cout << "Error : Collection file (" << collection << ") has no problems" << endl;
+		MPI_Abort(MPI_COMM_WORLD, -1);
+	}
+
+	// Every problem is solved by one worker, without other nodes to synchronize or migrate with
+	Options worker_options = options;
+	if ((options.SYNC_BATCH || options.ISLAND != MIGRATION_NONE) && mpi_rank == mpi_root)
+		cerr << "Warning : -S and -I ignored in batch mode" << endl;
+	worker_options.SYNC_BATCH = false;
+	worker_options.OVERLAP = false;
+	worker_options.ISLAND = MIGRATION_NONE;
+	worker_options.LOG_LEVEL = 0;
+	worker_options.TELEMETRY_FILE = "";
+	if ((options.CHECKPOINT_FILE != "" || options.RESUME_FILE != "") && mpi_rank == mpi_root)
+		cerr << "Warning : --checkpoint and --resume ignored in batch mode" << endl;
+	worker_options.CHECKPOINT_FILE = worker_options.RESUME_FILE = "";
+
+	// Biggest problems first
+	vector<long long> sizes(count);
+	for (int i = 0; i < count; i++)
+		sizes[i] = problem_size(names[i]);
+	vector<int> queue(count);
+	iota(queue.begin(), queue.end(), 0);
+	stable_sort(queue.begin(), queue.end(), [&](int a, int b) { return sizes[a] > sizes[b]; });
+
+	auto start = high_resolution_clock::now();
+
+	// Position of the next problem of the queue, in a window of root
+	int64_t *next;
+	MPI_Win window;
+	MPI_Win_allocate(mpi_rank == mpi_root ? sizeof(int64_t) : 0, sizeof(int64_t), MPI_INFO_NULL, MPI_COMM_WORLD, &next, &window);
+	if (mpi_rank == mpi_root)
+		*next = 0;
+	MPI_Barrier(MPI_COMM_WORLD);
+	MPI_Win_lock_all(0, window);
+
+	// Collectives of the algorithm can not run at the same time on the same communicator, each worker has its own
+	int workers = concurrent ? omp_get_max_threads() : 1;
+	vector<MPI_Comm> worker_comms(workers);
+	for (int w = 0; w < workers; w++)
+		MPI_Comm_dup(MPI_COMM_SELF, &worker_comms[w]);
+
+	vector<BatchResult> results;
+#pragma omp parallel num_threads(workers) if (workers > 1)
+	{
+		int worker = omp_get_thread_num();
+		Options thread_options = worker_options;
+		GeneticBuffers buffers;
+		vector<BatchResult> thread_results;
+
+		while (true)
+		{
+			const int64_t one = 1;
+			int64_t taken;
+			MPI_Fetch_and_op(&one, &taken, MPI_INT64_T, mpi_root, 0, MPI_SUM, window);
+			MPI_Win_flush(mpi_root, window);
+			if (taken >= count)
+				break;
+
+			thread_results.push_back(solve_problem(names, queue[taken], thread_options, worker_comms[worker], mpi_rank, worker, oss, buffers));
+		}
+
+#pragma omp critical(batch_results)
+		results.insert(results.end(), thread_results.begin(), thread_results.end());
+	}
+
+	MPI_Win_unlock_all(window);
+	MPI_Win_free(&window);
+	for (int w = 0; w < workers; w++)
+		MPI_Comm_free(&worker_comms[w]);
+
+	// Root gathers the results of every node
+	int bytes = results.size() * sizeof(BatchResult);
+	vector<int> received_bytes(mpi_size), displacements(mpi_size);
+	MPI_Gather(&bytes, 1, MPI_INT, received_bytes.data(), 1, MPI_INT, mpi_root, MPI_COMM_WORLD);
+	vector<BatchResult> all_results;
+	if (mpi_rank == mpi_root)
+	{
+		for (int i = 1; i < mpi_size; i++)
+			displacements[i] = displacements[i - 1] + received_bytes[i - 1];
+		all_results.resize((displacements[mpi_size - 1] + received_bytes[mpi_size - 1]) / sizeof(BatchResult));
+	}
+	MPI_Gatherv(results.data(), bytes, MPI_BYTE, all_results.data(), received_bytes.data(), displacements.data(), MPI_BYTE, mpi_root, MPI_COMM_WORLD);
+
+	if (mpi_rank == mpi_root)
+	{
+		double seconds = duration_cast<microseconds>(high_resolution_clock::now() - start).count() / 1e6;
+		print_results(names, all_results, oss);
+		cerr << "Instances per second : " << count / seconds << endl;
+	}
+}
@@ -0,0 +1,34 @@
+/**
+ * @file batch.h
+ * @author Javier Vela
+ * @brief Header file of the batch mode, the problems of a collection solved by all nodes and threads
+ * @version 0.1
+ * @date 2022-01-04
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <iostream>
+#include "tsplib.h"
+
+/// Result of a problem of the collection
+struct BatchResult
+{
+	int32_t instance;  // Line of the problem in the collection
+	int32_t dimension;
+	float best, optimal; // Fitness found and optimal cost (0 if unknown)
+	int64_t time;      // Microseconds of the algorithm
+	int32_t rank, worker; // Node and thread that solved it
+};
+
+std::vector<std::string> readCollection(const std::string &collection);
+void GenAlgBatch(const std::string &collection, Options &options, int mpi_rank, int mpi_size, int mpi_root, bool concurrent, std::ostream &oss);
+
+#endif /* BATCH_H */
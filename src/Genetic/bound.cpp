@@ -0,0 +1,457 @@
+/**
+ * @file bound.cpp
+ * @author Javier Vela
+ * @brief Source file of the lower bound of the optimal tour, Held-Karp 1-trees improved by subgradient ascent
+ * @version 0.1
+ * @date 2022-01-07
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include "bound.h"
+#include "distance.h"
+#include "population.h"
+#include "fitness.h"
+#include "seeding.h"
+#include "random.h"
+#include "profiler.h"
+
+using namespace std;
+
+/// Edge of a 1-tree, ordered by cost and then by its cities so that ties are always broken the same way
+struct TreeEdge
+{
+	double cost;
+	int a, b; // a < b
+
+	inline bool operator<(const TreeEdge &e) const
+	{
+		return cost < e.cost || (cost == e.cost && (a < e.a || (a == e.a && b < e.b)));
+	}
+};
+
+/// Candidate graph of the ascent, the cached neighbours of every city, the cities that have it as neighbour and the
+/// edges of the complete 1-trees that were missing
+struct CandidateGraph
+{
+	vector<vector<int>> adjacent; // Cities joined to every city, sorted
+	vector<int> first;            // Edges of city i in [first[i], first[i + 1])
+	vector<int> city;
+	vector<float> length;
+};
+
+/// Scratch memory of the 1-trees of the ascent
+struct OneTree
+{
+	vector<int> parent;        // Union-find parent of every city
+	vector<int> label;         // Component of every city at the start of a round
+	vector<int> degree;
+	vector<TreeEdge> cheapest; // Cheapest edge leaving the component of every city, and of every component (at its label)
+	vector<TreeEdge> leaving;
+	double length;
+};
+
+/**
+ * @brief Add the edges to the candidate graph and store it again in flat arrays
+ */
+template <class Distances>
+static void add_candidates(CandidateGraph &graph, int n, const vector<pair<int, int>> &edges, const Distances &distances)
+{
+	vector<vector<int>> &adjacent = graph.adjacent;
+	adjacent.resize(n + 1);
+	for (const pair<int, int> &edge : edges)
+	{
+		adjacent[edge.first].push_back(edge.second);
+		adjacent[edge.second].push_back(edge.first);
+	}
+
+	graph.first.assign(n + 2, 0);
+	for (int i = 1; i <= n; i++)
+	{
+		sort(adjacent[i].begin(), adjacent[i].end());
+		adjacent[i].erase(unique(adjacent[i].begin(), adjacent[i].end()), adjacent[i].end());
+		graph.first[i + 1] = graph.first[i] + adjacent[i].size();
+	}
+	graph.city.resize(graph.first[n + 1]);
+	graph.length.resize(graph.first[n + 1]);
+	for (int i = 1; i <= n; i++)
+	{
+		for (size_t e = 0; e < adjacent[i].size(); e++)
+		{
+			graph.city[graph.first[i] + e] = adjacent[i][e];
+			graph.length[graph.first[i] + e] = distances(i, adjacent[i][e]);
+		}
+	}
+}
+
+static inline int find_root(vector<int> &parent, int i)
+{
+	while (parent[i] != i)
+		i = parent[i] = parent[parent[i]];
+	return i;
+}
+
+/**
+ * @brief Round of Boruvka's algorithm over cities 2..n, every component joins the cheapest edge that leaves it
+ *
+ * The cheapest edge of every city is searched in parallel, among its candidates or, if <dense>, among all cities.
+ *
+ * @return number of components joined
+ */
+template <class Distances>
+static int boruvka_round(OneTree &tree, int n, const CandidateGraph &graph, const Distances &distances, const vector<double> &pi, bool dense)
+{
+	for (int i = 2; i <= n; i++)
+		tree.label[i] = find_root(tree.parent, i);
+
+#pragma omp parallel for schedule(dynamic, 256)
+	for (int i = 2; i <= n; i++)
+	{
+		TreeEdge best = {INFINITY, 0, 0};
+		int label = tree.label[i];
+		int begin = dense ? 2 : graph.first[i], end = dense ? n + 1 : graph.first[i + 1];
+		for (int e = begin; e < end; e++)
+		{
+			int j = dense ? e : graph.city[e];
+			if (j < 2 || tree.label[j] == label)
+				continue;
+			TreeEdge edge = {(dense ? distances(i, j) : graph.length[e]) + pi[i] + pi[j], min(i, j), max(i, j)};
+			if (edge < best)
+				best = edge;
+		}
+		tree.cheapest[i] = best;
+	}
+
+	for (int i = 2; i <= n; i++)
+	{
+		if (tree.cheapest[i] < tree.leaving[tree.label[i]])
+			tree.leaving[tree.label[i]] = tree.cheapest[i];
+	}
+
+	int joined = 0;
+	for (int i = 2; i <= n; i++)
+	{
+		if (tree.label[i] != i || tree.leaving[i].cost == INFINITY)
+			continue;
+		TreeEdge edge = tree.leaving[i];
+		tree.leaving[i].cost = INFINITY;
+		int ra = find_root(tree.parent, edge.a), rb = find_root(tree.parent, edge.b);
+		if (ra == rb)
+			continue;
+		tree.parent[ra] = rb;
+		tree.length += edge.cost;
+		tree.degree[edge.a]++;
+		tree.degree[edge.b]++;
+		joined++;
+	}
+	return joined;
+}
+
+/**
+ * @brief Minimum 1-tree of the candidate graph with edge costs d(i, j) + pi[i] + pi[j]
+ *
+ * Spanning tree of cities 2..n plus the two cheapest edges of city 1. Candidate edges are joined first, edges to any
+ * city only when no candidate edge joins two components.
+ *
+ * @return w(pi), length of the 1-tree minus 2 sum(pi)
+ */
+template <class Distances>
+static double candidate_one_tree(OneTree &tree, int n, const CandidateGraph &graph, const Distances &distances, const vector<double> &pi)
+{
+	for (int i = 1; i <= n; i++)
+	{
+		tree.parent[i] = i;
+		tree.degree[i] = 0;
+	}
+	tree.length = 0;
+
+	for (int components = n - 1; components > 1;)
+	{
+		int joined = boruvka_round(tree, n, graph, distances, pi, false);
+		if (joined == 0)
+			joined = boruvka_round(tree, n, graph, distances, pi, true);
+		components -= joined;
+	}
+
+	// City 1 joins the tree by its two cheapest edges (to any city if it has less than two candidates)
+	bool dense = graph.first[2] - graph.first[1] < 2;
+	int begin = dense ? 2 : graph.first[1], end = dense ? n + 1 : graph.first[2];
+	TreeEdge first = {INFINITY, 0, 0}, second = first;
+	for (int e = begin; e < end; e++)
+	{
+		int j = dense ? e : graph.city[e];
+		TreeEdge edge = {(dense ? distances(1, j) : graph.length[e]) + pi[1] + pi[j], 1, j};
+		if (edge < first)
+		{
+			second = first;
+			first = edge;
+		}
+		else if (edge < second)
+			second = edge;
+	}
+	tree.length += first.cost + second.cost;
+	tree.degree[1] = 2;
+	tree.degree[first.b]++;
+	tree.degree[second.b]++;
+
+	double sum = 0;
+	for (int i = 1; i <= n; i++)
+		sum += pi[i];
+	return tree.length - 2 * sum;
+}
+
+/**
+ * @brief Minimum 1-tree over all the edges of the problem with edge costs d(i, j) + pi[i] + pi[j], by Prim's algorithm
+ *
+ * Every step updates the distances of the cities out of the tree to the last city joined and finds the nearest one,
+ * both split between the threads.
+ *
+ * @return w(pi), a lower bound of the optimal tour for any pi
+ */
+template <class Distances>
+static double dense_one_tree(int n, const Distances &distances, const vector<double> &pi, vector<pair<int, int>> &edges)
+{
+	vector<double> key(n + 1, INFINITY);
+	vector<int> parent(n + 1, 2);
+	vector<char> joined(n + 1, 0);
+	double length = 0;
+	int last = 2;
+	joined[2] = 1;
+	double nearest_key = INFINITY;
+	int nearest = 0;
+
+#pragma omp parallel
+	{
+		for (int step = 2; step < n; step++)
+		{
+			double thread_key = INFINITY;
+			int thread_nearest = 0;
+#pragma omp for schedule(static) nowait
+			for (int j = 3; j <= n; j++)
+			{
+				if (joined[j])
+					continue;
+				double cost = distances(last, j) + pi[last] + pi[j];
+				if (cost < key[j])
+				{
+					key[j] = cost;
+					parent[j] = last;
+				}
+				if (key[j] < thread_key)
+				{
+					thread_key = key[j];
+					thread_nearest = j;
+				}
+			}
+#pragma omp critical
+			{
+				if (thread_nearest != 0 && (thread_key < nearest_key || (thread_key == nearest_key && thread_nearest < nearest)))
+				{
+					nearest_key = thread_key;
+					nearest = thread_nearest;
+				}
+			}
+#pragma omp barrier
+#pragma omp single
+			{
+				joined[nearest] = 1;
+				length += nearest_key;
+				last = nearest;
+				nearest_key = INFINITY;
+				nearest = 0;
+			}
+		}
+	}
+
+	double first = INFINITY, second = INFINITY;
+	int first_city = 2, second_city = 3;
+	for (int j = 2; j <= n; j++)
+	{
+		double cost = distances(1, j) + pi[1] + pi[j];
+		if (cost < first)
+		{
+			second = first;
+			second_city = first_city;
+			first = cost;
+			first_city = j;
+		}
+		else if (cost < second)
+		{
+			second = cost;
+			second_city = j;
+		}
+	}
+
+	edges.clear();
+	for (int j = 3; j <= n; j++)
+		edges.push_back(make_pair(j, parent[j]));
+	edges.push_back(make_pair(1, first_city));
+	edges.push_back(make_pair(1, second_city));
+
+	double sum = 0;
+	for (int i = 1; i <= n; i++)
+		sum += pi[i];
+	return length + first + second - 2 * sum;
+}
+
+/**
+ * @brief Subgradient ascent of w(pi) on the candidate graph
+ *
+ * Every iteration moves pi[i] by t (degree(i) - 2), with the step t = lambda (upper_bound - w) / |degree - 2|^2.
+ * lambda starts at 2 and is halved after BOUND_PERIOD iterations without a better w.
+ *
+ * @param pi penalties the ascent starts from, where to return the ones of the best w
+ * @return best w(pi) of the candidate graph
+ */
+template <class Distances>
+static double subgradient_ascent(OneTree &tree, int n, const CandidateGraph &graph, const Distances &distances, vector<double> &pi, double upper_bound)
+{
+	vector<double> best_pi(pi);
+	double best = -INFINITY, lambda = 2;
+	int stalled = 0;
+	for (int iteration = 0; iteration < BOUND_ITERATIONS && lambda > 1e-4; iteration++)
+	{
+		double w = candidate_one_tree(tree, n, graph, distances, pi);
+		if (w > best)
+		{
+			best = w;
+			best_pi = pi;
+			stalled = 0;
+		}
+		else if (++stalled == BOUND_PERIOD)
+		{
+			lambda /= 2;
+			stalled = 0;
+		}
+
+		// Every city has two edges, the 1-tree is a tour and can not be improved
+		long long norm = 0;
+		for (int i = 1; i <= n; i++)
+			norm += (long long)(tree.degree[i] - 2) * (tree.degree[i] - 2);
+		if (norm == 0 || w >= upper_bound)
+			break;
+
+		double t = lambda * (upper_bound - w) / norm;
+#pragma omp parallel for schedule(static)
+		for (int i = 1; i <= n; i++)
+			pi[i] += t * (tree.degree[i] - 2);
+	}
+	pi = best_pi;
+	return best;
+}
+
+/**
+ * @brief Held-Karp bound, ascent on the candidate graph checked against all the edges of the problem
+ *
+ * The 1-tree of the candidate graph can not be shorter than the one over all edges, it is only a bound if both are the
+ * same. Otherwise the edges of the complete 1-tree are added to the candidate graph and the ascent goes on from the
+ * best penalties, for up to BOUND_ROUNDS rounds.
+ */
+template <class Distances>
+static double ascent(const Map &tsp, const Distances &distances, double upper_bound)
+{
+	int n = tsp.dimension;
+
+	// A single tour
+	if (n < 4)
+	{
+		vector<gene_t> tour(n);
+		for (int i = 0; i < n; i++)
+			tour[i] = i + 1;
+		return calculate_fitness(tour.data(), n, distances);
+	}
+
+	// Neighbours and the minimum 1-tree, so that the candidate graph is connected
+	vector<double> pi(n + 1, 0);
+	vector<pair<int, int>> edges;
+	double bound = dense_one_tree(n, distances, pi, edges);
+	for (int i = 1; i <= n; i++)
+	{
+		for (int k = 0; k < tsp.neighbourK; k++)
+			edges.push_back(make_pair(i, tsp.neighbours[(size_t)i * tsp.neighbourK + k]));
+	}
+	CandidateGraph graph;
+	add_candidates(graph, n, edges, distances);
+
+	OneTree tree;
+	tree.parent.resize(n + 1);
+	tree.label.resize(n + 1);
+	tree.degree.resize(n + 1);
+	tree.cheapest.resize(n + 1);
+	tree.leaving.assign(n + 1, {INFINITY, 0, 0});
+
+	for (int round = 0; round < BOUND_ROUNDS; round++)
+	{
+		double w = subgradient_ascent(tree, n, graph, distances, pi, upper_bound);
+		double complete = dense_one_tree(n, distances, pi, edges);
+		bound = max(bound, complete);
+		if (complete >= w - 1e-9 * fabs(w))
+			break;
+		add_candidates(graph, n, edges, distances);
+	}
+	return bound;
+}
+
+/**
+ * @brief Held-Karp lower bound of the optimal tour of a symmetric problem
+ *
+ * The ascent runs on the candidate graph of the neighbour cache (EXPECTED to be built) in O(n K log n) per iteration,
+ * every round checks it with a 1-tree over all the edges in O(n^2).
+ *
+ * @param tsp TSP problem
+ * @param upper_bound length of a tour, the target of the steps of the ascent
+ * @return lower bound of the length of the optimal tour
+ */
+double one_tree_bound(Map &tsp, double upper_bound)
+{
+	PROFILE_SCOPE(PHASE_BOUND);
+	double bound;
+	withDistances(tsp, [&](const auto &distances) {
+		bound = ascent(tsp, distances, upper_bound);
+	});
+	return bound;
+}
+
+/**
+ * @brief Lower bound of the optimal tour for the stopping rules of the Genetic Algorithm
+ *
+ * Root computes it with all its threads, the other nodes wait for the result.
+ *
+ * @param tsp TSP Problem, symmetric
+ * @param options parameters of the run (CANDIDATES, SEED)
+ * @param comm MPI nodes of the run
+ * @param mpi_root MPI rank of the root node in comm
+ * @param upper_bound length of the fittest tour known (root), a greedy tour is used if it is shorter
+ * @return lower bound of the length of the optimal tour
+ */
+double LowerBound(Map &tsp, Options &options, MPI_Comm comm, int mpi_root, float upper_bound)
+{
+	int mpi_rank;
+	MPI_Comm_rank(comm, &mpi_rank);
+
+	double bound;
+	if (mpi_rank == mpi_root)
+	{
+		if (tsp.neighbourK < options.CANDIDATES)
+			buildNeighbourCache(tsp, options.CANDIDATES);
+
+		// Steps are proportional to the distance to the upper bound, a random initial population would make them too long
+		if (tsp.dimension >= 4)
+		{
+			vector<gene_t> tour(tsp.dimension);
+			Seeding seeding;
+			Rng rng = stream_rng(options.SEED, 0);
+			seed_gnome(tour.data(), tsp, SEED_GREEDY_EDGE, rng, seeding);
+			withDistances(tsp, [&](const auto &distances) {
+				upper_bound = min(upper_bound, calculate_fitness(tour.data(), tsp.dimension, distances));
+			});
+		}
+		bound = one_tree_bound(tsp, upper_bound);
+	}
+	MPI_Bcast(&bound, 1, MPI_DOUBLE, mpi_root, comm);
+	return bound;
+}
@@ -0,0 +1,36 @@
+/**
+ * @file bound.h
+ * @author Javier Vela
+ * @brief Header file of the lower bound of the optimal tour, Held-Karp 1-trees improved by subgradient ascent
+ * @version 0.1
+ * @date 2022-01-07
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef BOUND_H
+#define BOUND_H
+
+#include "tsplib.h"
+#include "mpi.h"
+
+/// Most iterations of the subgradient ascent
+#ifndef BOUND_ITERATIONS
+#define BOUND_ITERATIONS 1000
+#endif
+
+/// Iterations without a better bound before the step of the ascent is halved
+#ifndef BOUND_PERIOD
+#define BOUND_PERIOD 20
+#endif
+
+/// Most rounds of the ascent, the complete 1-tree of every round adds its edges to the candidate graph of the next
+#ifndef BOUND_ROUNDS
+#define BOUND_ROUNDS 4
+#endif
+
+double one_tree_bound(Map &tsp, double upper_bound);
+double LowerBound(Map &tsp, Options &options, MPI_Comm comm, int mpi_root, float upper_bound);
+
+#endif /* BOUND_H */
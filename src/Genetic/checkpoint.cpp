@@ -0,0 +1,270 @@
+/**
+ * @file checkpoint.cpp
+ * @author Javier Vela
+ * @brief Source file of the checkpoints of the Genetic Algorithm, the state of every node saved to resume the run later
+ * @version 0.1
+ * @date 2022-01-06
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <cstdio>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include "checkpoint.h"
+
+using namespace std;
+
+/// "TSPC"
+#define CHECKPOINT_MAGIC 0x43505354
+
+/**
+ * @brief Start the checkpoints of a node. Nothing is saved if <name> is empty.
+ *
+ * @param checkpoint checkpoints to initialize
+ * @param name files of the checkpoints, <name>.<rank> for every node
+ * @param every batches between two checkpoints
+ * @param seed seed of the run, saved to be resumed with it
+ */
+void init_checkpoint(Checkpoint &checkpoint, const string &name, int every, int mpi_rank, int mpi_size, unsigned long long seed)
+{
+	checkpoint.enabled = name != "";
+	if (!checkpoint.enabled)
+		return;
+
+	checkpoint.file_name = name + "." + to_string(mpi_rank);
+	checkpoint.every = every;
+	checkpoint.batches = 0;
+	checkpoint.header.magic = CHECKPOINT_MAGIC;
+	checkpoint.header.version = CHECKPOINT_VERSION;
+	checkpoint.header.mpi_rank = mpi_rank;
+	checkpoint.header.mpi_size = mpi_size;
+	checkpoint.header.seed = seed;
+	checkpoint.writing = false;
+	checkpoint.written = checkpoint.skipped = 0;
+}
+
+/**
+ * @brief Copy the state of the node to be written
+ */
+static void take_snapshot(Checkpoint &checkpoint, Population &population, int generation, const vector<Rng> &rngs, float last_improved_fitness)
+{
+	resize_population(checkpoint.snapshot, population.size, population.length);
+	append_population(checkpoint.snapshot, 0, population);
+	checkpoint.snapshot.order = population.order;
+
+	checkpoint.header.generation = generation;
+	checkpoint.header.dimension = population.length;
+	checkpoint.header.size = population.size;
+	checkpoint.header.threads = rngs.size();
+	checkpoint.header.last_improved_fitness = last_improved_fitness;
+
+	checkpoint.rngs.clear();
+	for (const Rng &rng : rngs)
+		checkpoint.rngs.insert(checkpoint.rngs.end(), rng.s, rng.s + 4);
+}
+
+/**
+ * @brief Encode the snapshot against its fittest tour and write it (writer thread, or the caller at the end)
+ */
+static void write_checkpoint(Checkpoint &checkpoint)
+{
+	Population &snapshot = checkpoint.snapshot;
+	const gene_t *best = gnome(snapshot, snapshot.order[0]);
+	init_codec(checkpoint.codec, snapshot.length);
+	set_codec_reference(checkpoint.codec, best);
+	checkpoint.buffer.clear();
+	encode_population(checkpoint.codec, snapshot, snapshot.size, checkpoint.buffer);
+	checkpoint.header.bytes = checkpoint.buffer.size();
+
+	vector<int32_t> reference(best, best + snapshot.length);
+	string temporary = checkpoint.file_name + ".tmp";
+	ofstream file(temporary, ios::out | ios::binary);
+	file.write((const char *)&checkpoint.header, sizeof(CheckpointHeader));
+	file.write((const char *)checkpoint.rngs.data(), checkpoint.rngs.size() * sizeof(uint64_t));
+	file.write((const char *)reference.data(), reference.size() * sizeof(int32_t));
+	file.write((const char *)checkpoint.buffer.data(), checkpoint.buffer.size());
+	file.close();
+
+	// The previous checkpoint is only replaced by a complete one
+	if (!file || rename(temporary.c_str(), checkpoint.file_name.c_str()) != 0)
+		cerr << "Warning : checkpoint " << checkpoint.file_name << " can not be written" << endl;
+	else
+		checkpoint.written++;
+	checkpoint.writing = false;
+}
+
+/**
+ * @brief Save the state of the node every <every> batches, never waits for the disk
+ *
+ * If the previous checkpoint is still being written this one is skipped, and the next batch tries again.
+ *
+ * @param checkpoint checkpoints of the node
+ * @param population population, EXPECTED to be sorted
+ * @param generation next generation to breed
+ * @param rngs random streams of every thread
+ * @param last_improved_fitness fitness of the last elite taken to a local optimum
+ */
+void save_checkpoint(Checkpoint &checkpoint, Population &population, int generation, const vector<Rng> &rngs, float last_improved_fitness)
+{
+	if (!checkpoint.enabled || ++checkpoint.batches < checkpoint.every)
+		return;
+	if (checkpoint.writing)
+	{
+		checkpoint.skipped++;
+		return;
+	}
+
+	checkpoint.batches = 0;
+	if (checkpoint.writer.joinable())
+		checkpoint.writer.join();
+	take_snapshot(checkpoint, population, generation, rngs, last_improved_fitness);
+	checkpoint.writing = true;
+	checkpoint.writer = thread(write_checkpoint, ref(checkpoint));
+}
+
+/**
+ * @brief Wait for the checkpoint being written and save the final state of the node
+ */
+void finish_checkpoint(Checkpoint &checkpoint, Population &population, int generation, const vector<Rng> &rngs, float last_improved_fitness)
+{
+	if (!checkpoint.enabled)
+		return;
+
+	if (checkpoint.writer.joinable())
+		checkpoint.writer.join();
+	take_snapshot(checkpoint, population, generation, rngs, last_improved_fitness);
+	write_checkpoint(checkpoint);
+
+	if (checkpoint.skipped > 0)
+		cerr << "Warning : " << checkpoint.skipped << " checkpoints of node " << checkpoint.header.mpi_rank << " skipped, the previous one was still being written" << endl;
+	checkpoint.enabled = false;
+}
+
+/**
+ * @brief Read the checkpoint file of a node
+ *
+ * @param file_name checkpoint file, <name>.<rank>
+ * @param header where to read its header
+ * @param rngs where to read the state of its random streams
+ * @param individuals where to decode its individuals, fittest first
+ */
+static void read_checkpoint(const string &file_name, CheckpointHeader &header, vector<uint64_t> &rngs, Population &individuals)
+{
+	ifstream file(file_name, ios::in | ios::binary);
+	if (!file.read((char *)&header, sizeof(CheckpointHeader)))
+	{
+		cout << "Error : Checkpoint file (" << file_name << ") not found" << endl;
+		MPI_Abort(MPI_COMM_WORLD, -1);
+	}
+	if (header.magic != CHECKPOINT_MAGIC || header.version != CHECKPOINT_VERSION)
+	{
+		cout << "Error : " << file_name << " is not a checkpoint of version " << CHECKPOINT_VERSION << endl;
+		MPI_Abort(MPI_COMM_WORLD, -1);
+	}
+
+	rngs.resize((size_t)header.threads * 4);
+	vector<int32_t> reference(header.dimension);
+	vector<uint8_t> buffer(header.bytes);
+	file.read((char *)rngs.data(), rngs.size() * sizeof(uint64_t));
+	file.read((char *)reference.data(), reference.size() * sizeof(int32_t));
+	file.read((char *)buffer.data(), buffer.size());
+	if (!file)
+	{
+		cout << "Error : Checkpoint file (" << file_name << ") is truncated" << endl;
+		MPI_Abort(MPI_COMM_WORLD, -1);
+	}
+
+	TourCodec codec;
+	init_codec(codec, header.dimension);
+	vector<gene_t> tour(reference.begin(), reference.end());
+	set_codec_reference(codec, tour.data());
+	resize_population(individuals, header.size, header.dimension);
+	decode_population(codec, buffer.data(), individuals, 0, header.size);
+}
+
+/**
+ * @brief Resume the state of the node from the checkpoint files of a previous run, collective over all nodes
+ *
+ * With as many nodes as the previous run every node takes its own file. With fewer, node r takes the files r,
+ * r + mpi_size... With more, the nodes that share a file take every k-th of its individuals. The fittest individuals
+ * taken fill the population, the caller fills the rest if there are less.
+ *
+ * All nodes resume from the oldest generation of their files. The random streams are resumed if the number of nodes and
+ * threads did not change, otherwise new streams of the seed and generation are used.
+ *
+ * @param name files of the checkpoints, <name>.<rank> for every node of the previous run
+ * @param comm MPI nodes of the run
+ * @param population population of the node, with the size it must have (individuals are written from 0)
+ * @param rngs random streams of every thread
+ * @param generation where to return the next generation to breed
+ * @param last_improved_fitness where to return the fitness of the last elite taken to a local optimum
+ * @param seed where to return the seed of the previous run
+ * @return number of individuals resumed
+ */
+int load_checkpoint(const string &name, MPI_Comm comm, int mpi_rank, int mpi_size, Population &population, vector<Rng> &rngs, int &generation, float &last_improved_fitness, unsigned long long &seed)
+{
+	CheckpointHeader header;
+	vector<uint64_t> file_rngs;
+	Population individuals, taken;
+
+	// Nodes of the previous run
+	read_checkpoint(name + ".0", header, file_rngs, individuals);
+	int old_size = header.mpi_size;
+	if (header.dimension != population.length)
+	{
+		cout << "Error : Checkpoint of " << header.dimension << " cities, the problem has " << population.length << endl;
+		MPI_Abort(MPI_COMM_WORLD, -1);
+	}
+
+	int first = mpi_rank % old_size, step = mpi_size, part = 0, parts = 1;
+	if (mpi_size > old_size)
+	{
+		step = old_size;
+		part = mpi_rank / old_size;
+		parts = (mpi_size - first + old_size - 1) / old_size;
+	}
+
+	int oldest = INT32_MAX;
+	resize_population(taken, 0, population.length);
+	for (int file = first; file < old_size; file += step)
+	{
+		read_checkpoint(name + "." + to_string(file), header, file_rngs, individuals);
+		oldest = min(oldest, header.generation);
+		int at = taken.size;
+		resize_population(taken, at + max(0, (individuals.size - part + parts - 1) / parts), population.length);
+		for (int i = part; i < individuals.size; i += parts, at++)
+		{
+			memcpy(gnome(taken, at), gnome(individuals, i), population.length * sizeof(gene_t));
+			taken.fitness[at] = individuals.fitness[i];
+		}
+
+		// Streams of the node continue where they were
+		if (old_size == mpi_size && header.threads == (int)rngs.size())
+		{
+			for (size_t t = 0; t < rngs.size(); t++)
+				memcpy(rngs[t].s, &file_rngs[4 * t], sizeof(rngs[t].s));
+		}
+		else
+		{
+			for (size_t t = 0; t < rngs.size(); t++)
+				rngs[t] = stream_rng(header.seed ^ ((uint64_t)header.generation << 32), (uint64_t)mpi_rank * rngs.size() + t);
+		}
+		last_improved_fitness = header.last_improved_fitness;
+		seed = header.seed;
+	}
+
+	MPI_Allreduce(&oldest, &generation, 1, MPI_INT, MPI_MIN, comm);
+
+	sort_population(taken, true);
+	int resumed = min(taken.size, population.size);
+	for (int i = 0; i < resumed; i++)
+	{
+		memcpy(gnome(population, i), gnome(taken, taken.order[i]), population.length * sizeof(gene_t));
+		population.fitness[i] = taken.fitness[taken.order[i]];
+	}
+	return resumed;
+}
@@ -0,0 +1,71 @@
+/**
+ * @file checkpoint.h
+ * @author Javier Vela
+ * @brief Header file of the checkpoints of the Genetic Algorithm, the state of every node saved to resume the run later
+ * @version 0.1
+ * @date 2022-01-06
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include "population.h"
+#include "random.h"
+#include "codec.h"
+#include "mpi.h"
+
+/// Version of the checkpoint files, files of other versions can not be resumed
+#define CHECKPOINT_VERSION 1
+
+/// First bytes of a checkpoint file of a node
+struct CheckpointHeader
+{
+	uint32_t magic;              // "TSPC"
+	uint32_t version;
+	int32_t mpi_rank, mpi_size;  // Node that wrote the file and nodes of its run
+	int32_t generation;          // Next generation to breed
+	int32_t dimension;
+	int32_t size;                // Individuals, fittest first
+	int32_t threads;             // Random streams
+	uint64_t seed;
+	float last_improved_fitness; // Fitness of the last elite taken to a local optimum
+	uint32_t bytes;              // Encoded individuals
+};
+
+/**
+ * @brief Checkpoints of a node
+ *
+ * The file <name>.<rank> holds the header, the state of the random streams, the fittest tour and the individuals
+ * encoded against it. A copy of the population is encoded and written by a writer thread into <name>.<rank>.tmp, then
+ * renamed, so the generation loop does not wait for the disk and a job killed while writing keeps the previous file.
+ */
+struct Checkpoint
+{
+	bool enabled;
+	std::string file_name;    // <name>.<rank>
+	int every;                // Batches between two checkpoints
+	int batches;              // Batches since the last checkpoint
+	CheckpointHeader header;  // Of the checkpoint being written
+	Population snapshot;      // Copy of the population being written
+	std::vector<uint64_t> rngs; // State of the random streams being written
+	TourCodec codec;
+	std::vector<uint8_t> buffer;
+	std::thread writer;
+	std::atomic<bool> writing;
+	long long written, skipped; // Checkpoints written and skipped because the previous one was still being written
+};
+
+void init_checkpoint(Checkpoint &checkpoint, const std::string &name, int every, int mpi_rank, int mpi_size, unsigned long long seed);
+void save_checkpoint(Checkpoint &checkpoint, Population &population, int generation, const std::vector<Rng> &rngs, float last_improved_fitness);
+void finish_checkpoint(Checkpoint &checkpoint, Population &population, int generation, const std::vector<Rng> &rngs, float last_improved_fitness);
+int load_checkpoint(const std::string &name, MPI_Comm comm, int mpi_rank, int mpi_size, Population &population, std::vector<Rng> &rngs, int &generation, float &last_improved_fitness, unsigned long long &seed);
+
+#endif /* CHECKPOINT_H */
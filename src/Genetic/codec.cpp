@@ -0,0 +1,237 @@
+/**
+ * @file codec.cpp
+ * @author Javier Vela
+ * @brief Source file of the compact wire format of the tours sent between MPI nodes
+ * @version 0.1
+ * @date 2021-12-22
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <cstring>
+#include <iostream>
+#include "codec.h"
+#include "profiler.h"
+
+using namespace std;
+
+/**
+ * @brief Prepare a codec for tours of <n> cities, without reference
+ */
+void init_codec(TourCodec &codec, int n)
+{
+	codec.n = n;
+	codec.reference.clear();
+	codec.reference_pos.clear();
+}
+
+/**
+ * @brief Set the reference tour the following messages are encoded or decoded against
+ */
+void set_codec_reference(TourCodec &codec, const gene_t *tour)
+{
+	codec.reference.assign(tour, tour + codec.n);
+	codec.reference_pos.resize(codec.n + 1);
+	for (int i = 0; i < codec.n; i++)
+		codec.reference_pos[tour[i]] = i;
+}
+
+/**
+ * @brief Bytes of the biggest message with <count> tours of <n> cities (every tour raw with 32-bit ids)
+ */
+size_t max_encoded_size(int n, int count)
+{
+	return 5 + (size_t)count * (sizeof(float) + 1 + (size_t)n * sizeof(uint32_t));
+}
+
+static inline void write_varint(vector<uint8_t> &buffer, uint32_t value)
+{
+	while (value >= 0x80)
+	{
+		buffer.push_back((uint8_t)(value | 0x80));
+		value >>= 7;
+	}
+	buffer.push_back((uint8_t)value);
+}
+
+static inline uint32_t read_varint(const uint8_t *&data)
+{
+	uint32_t value = 0;
+	for (int shift = 0;; shift += 7)
+	{
+		uint8_t b = *data++;
+		value |= (uint32_t)(b & 0x7f) << shift;
+		if (b < 0x80)
+			return value;
+	}
+}
+
+static inline int reference_next(TourCodec &codec, int city, int direction)
+{
+	int p = codec.reference_pos[city] + direction;
+	if (p == codec.n)
+		p = 0;
+	else if (p < 0)
+		p = codec.n - 1;
+	return codec.reference[p];
+}
+
+/**
+ * @brief Append the edge difference of <tour> against the reference: tokens of start city and (run length,
+ * direction), each run following the reference forward or backward from its start city
+ */
+static void encode_edge_diff(TourCodec &codec, const gene_t *tour, vector<uint8_t> &buffer)
+{
+	int i = 0;
+	while (i < codec.n)
+	{
+		int direction = 1, run = 0;
+		if (i + 1 < codec.n && tour[i + 1] == reference_next(codec, tour[i], -1))
+			direction = -1;
+		while (i + run + 1 < codec.n && tour[i + run + 1] == reference_next(codec, tour[i + run], direction))
+			run++;
+
+		write_varint(buffer, tour[i]);
+		write_varint(buffer, ((uint32_t)run << 1) | (direction < 0));
+		i += run + 1;
+	}
+}
+
+static void encode_tour(TourCodec &codec, const gene_t *tour, float fitness, vector<uint8_t> &buffer)
+{
+	size_t start = buffer.size();
+	buffer.resize(start + sizeof(float) + 1);
+	memcpy(&buffer[start], &fitness, sizeof(float));
+
+	bool wide = codec.n > 65535;
+	size_t raw_bytes = (size_t)codec.n * (wide ? sizeof(uint32_t) : sizeof(uint16_t));
+
+	// The edge difference is kept only when it is smaller than the raw tour
+	if (!codec.reference.empty())
+	{
+		buffer[start + sizeof(float)] = TOUR_EDGE_DIFF;
+		encode_edge_diff(codec, tour, buffer);
+		if (buffer.size() - start - sizeof(float) - 1 < raw_bytes)
+			return;
+		buffer.resize(start + sizeof(float) + 1);
+	}
+
+	buffer[start + sizeof(float)] = wide ? TOUR_RAW32 : TOUR_RAW16;
+	size_t at = buffer.size();
+	buffer.resize(at + raw_bytes);
+	for (int i = 0; i < codec.n; i++)
+	{
+		if (wide)
+		{
+			uint32_t city = tour[i];
+			memcpy(&buffer[at + i * sizeof(uint32_t)], &city, sizeof(uint32_t));
+		}
+		else
+		{
+			uint16_t city = tour[i];
+			memcpy(&buffer[at + i * sizeof(uint16_t)], &city, sizeof(uint16_t));
+		}
+	}
+}
+
+static const uint8_t *decode_tour(TourCodec &codec, const uint8_t *data, gene_t *tour, float &fitness)
+{
+	memcpy(&fitness, data, sizeof(float));
+	data += sizeof(float);
+	uint8_t encoding = *data++;
+
+	if (encoding == TOUR_RAW16)
+	{
+		for (int i = 0; i < codec.n; i++, data += sizeof(uint16_t))
+		{
+			uint16_t city;
+			memcpy(&city, data, sizeof(uint16_t));
+			tour[i] = city;
+		}
+	}
+	else if (encoding == TOUR_RAW32)
+	{
+		for (int i = 0; i < codec.n; i++, data += sizeof(uint32_t))
+		{
+			uint32_t city;
+			memcpy(&city, data, sizeof(uint32_t));
+			tour[i] = city;
+		}
+	}
+	else
+	{
+		int i = 0;
+		while (i < codec.n)
+		{
+			int city = read_varint(data);
+			uint32_t token = read_varint(data);
+			int direction = token & 1 ? -1 : 1;
+			tour[i++] = city;
+			for (uint32_t r = 0; r < token >> 1; r++)
+			{
+				city = reference_next(codec, city, direction);
+				tour[i++] = city;
+			}
+		}
+	}
+	return data;
+}
+
+/**
+ * @brief Append to <buffer> a message with the <first_n> fittest individuals of <population>
+ *
+ * @param codec codec of the link
+ * @param population population, EXPECTED to be sorted (repeats its fittest individuals if smaller than first_n)
+ * @param first_n number of individuals to encode
+ * @param buffer where to append the message
+ */
+void encode_population(TourCodec &codec, Population &population, int first_n, vector<uint8_t> &buffer)
+{
+	PROFILE_SCOPE(PHASE_ENCODING);
+	size_t start = buffer.size();
+	write_varint(buffer, first_n);
+	for (int i = 0; i < first_n; i++)
+	{
+		int indi = population.order[i % population.size];
+		encode_tour(codec, gnome(population, indi), population.fitness[indi], buffer);
+	}
+	PROFILE_COUNT(COUNTER_BYTES, buffer.size() - start);
+
+	if (CHECK_CODEC)
+	{
+		Population decoded;
+		resize_population(decoded, first_n, codec.n);
+		decode_population(codec, &buffer[start], decoded, 0, first_n);
+		for (int i = 0; i < first_n; i++)
+		{
+			int indi = population.order[i % population.size];
+			if (decoded.fitness[i] != population.fitness[indi] || memcmp(gnome(decoded, i), gnome(population, indi), codec.n * sizeof(gene_t)) != 0)
+			{
+				cerr << "Error : tour " << i << " does not survive encoding" << endl;
+				break;
+			}
+		}
+	}
+}
+
+/**
+ * @brief Decode a message into individuals <at>, <at> + 1... of <population>
+ *
+ * @param codec codec of the link, with the reference the message was encoded against
+ * @param data message
+ * @param population population with room for the decoded individuals
+ * @param at first individual to overwrite
+ * @param max_n maximum number of individuals to decode (the rest of the message is ignored)
+ * @return number of individuals decoded
+ */
+int decode_population(TourCodec &codec, const uint8_t *data, Population &population, int at, int max_n)
+{
+	PROFILE_SCOPE(PHASE_DECODING);
+	int count = read_varint(data);
+	if (count > max_n)
+		count = max_n;
+	for (int i = 0; i < count; i++)
+		data = decode_tour(codec, data, gnome(population, at + i), population.fitness[at + i]);
+	return count;
+}
@@ -0,0 +1,52 @@
+/**
+ * @file codec.h
+ * @author Javier Vela
+ * @brief Header file of the compact wire format of the tours sent between MPI nodes
+ * @version 0.1
+ * @date 2021-12-22
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef CODEC_H
+#define CODEC_H
+
+#include <cstdint>
+#include <vector>
+#include "population.h"
+
+/// Decode every encoded message again and compare it with the original individuals (debug)
+#ifndef CHECK_CODEC
+#define CHECK_CODEC 0
+#endif
+
+/// Encoding of a single tour in a message
+enum TourEncoding
+{
+	TOUR_RAW16,    // 16-bit city ids (problems under 65536 cities)
+	TOUR_RAW32,    // 32-bit city ids
+	TOUR_EDGE_DIFF // Runs of edges shared with the reference tour
+};
+
+/**
+ * @brief Reference tour shared by the sender and the receiver of a link
+ *
+ * Both ends must hold the same reference when a message is encoded and decoded. Tours of a population share most of
+ * their edges with its elite, so a tour is encoded as the runs it walks along the reference (start city, length and
+ * direction), which takes a few bytes per edge that is not in the reference.
+ */
+struct TourCodec
+{
+	int n;                            // Cities per tour
+	std::vector<gene_t> reference;    // Empty until the first reference is set (tours are then sent raw)
+	std::vector<int> reference_pos;   // Position of every city in the reference
+};
+
+void init_codec(TourCodec &codec, int n);
+void set_codec_reference(TourCodec &codec, const gene_t *tour);
+size_t max_encoded_size(int n, int count);
+void encode_population(TourCodec &codec, Population &population, int first_n, std::vector<uint8_t> &buffer);
+int decode_population(TourCodec &codec, const uint8_t *data, Population &population, int at, int max_n);
+
+#endif /* CODEC_H */
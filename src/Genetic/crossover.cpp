@@ -0,0 +1,443 @@
+/**
+ * @file crossover.cpp
+ * @author Javier Vela
+ * @brief Source file of the crossover operators (OX, PMX, EAX) that combine two gnomes of the Genetic Algorithm
+ * @version 0.1
+ * @date 2021-12-30
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <functional>
+#include "crossover.h"
+#include "distance.h"
+#include "profiler.h"
+
+using namespace std;
+
+/**
+ * @brief Allocate the scratch memory of the crossover operators for problems of <dimension> cities
+ *
+ * @param cx crossover scratch memory
+ * @param dimension number of cities
+ */
+void init_crossover(Crossover &cx, int dimension)
+{
+	cx.n = dimension;
+	cx.pos.assign(dimension + 1, 0);
+	cx.adj_a.assign(2 * (dimension + 1), 0);
+	cx.adj_b.assign(2 * (dimension + 1), 0);
+	cx.rem_a.assign(2 * (dimension + 1), 0);
+	cx.rem_b.assign(2 * (dimension + 1), 0);
+	cx.child.assign(2 * (dimension + 1), 0);
+	cx.path.reserve(2 * dimension + 1);
+	cx.at_even.assign(dimension + 1, -1);
+	cx.at_odd.assign(dimension + 1, -1);
+	cx.cycles.reserve(2 * dimension);
+	cx.cycle_start.reserve(dimension + 1);
+	cx.subtour.assign(dimension + 1, -1);
+	cx.subtour_size.reserve(dimension);
+	cx.subtour_city.reserve(dimension);
+	cx.members.reserve(dimension);
+	cx.smallest.reserve(2 * dimension);
+}
+
+/**
+ * @brief Random segment [<a>, <b>) of a tour of <n> cities, not empty
+ */
+static void random_segment(int n, Rng &rng, int &a, int &b)
+{
+	a = rand_num(rng, 0, n);
+	b = rand_num(rng, 0, n);
+	if (a > b)
+		swap(a, b);
+	b++;
+}
+
+/**
+ * @brief Order crossover (OX): the child keeps a segment of <p1> and the other cities in the order they have in <p2>
+ */
+static void order_crossover(const gene_t *p1, const gene_t *p2, gene_t *child, Rng &rng, Crossover &cx)
+{
+	int n = cx.n, a, b;
+	random_segment(n, rng, a, b);
+
+	for (int i = a; i < b; i++)
+	{
+		child[i] = p1[i];
+		cx.pos[p1[i]] = -1;
+	}
+
+	// Cities of p2 from the end of the segment on fill the child from the end of the segment on
+	int j = b == n ? 0 : b;
+	for (int k = 0; k < n; k++)
+	{
+		int i = b + k < n ? b + k : b + k - n;
+		if (cx.pos[p2[i]] != -1)
+		{
+			child[j] = p2[i];
+			j = j + 1 == n ? 0 : j + 1;
+		}
+	}
+
+	for (int i = a; i < b; i++)
+		cx.pos[p1[i]] = 0;
+}
+
+/**
+ * @brief Partially mapped crossover (PMX): the child keeps a segment of <p1> and the positions of <p2> elsewhere,
+ * cities displaced by the segment follow the mapping between the parents
+ */
+static void partially_mapped_crossover(const gene_t *p1, const gene_t *p2, gene_t *child, Rng &rng, Crossover &cx)
+{
+	int n = cx.n, a, b;
+	random_segment(n, rng, a, b);
+
+	for (int i = 0; i < n; i++)
+	{
+		child[i] = p2[i];
+		cx.pos[p2[i]] = i;
+	}
+
+	// Bringing every city of the segment to its position with a swap is the same as following the PMX mapping
+	for (int i = a; i < b; i++)
+	{
+		int j = cx.pos[p1[i]];
+		if (j == i)
+			continue;
+		swap(child[i], child[j]);
+		cx.pos[child[i]] = i;
+		cx.pos[child[j]] = j;
+	}
+}
+
+/* EAX */
+
+/**
+ * @brief Two neighbours of every city of <tour> (slots 2 * city and 2 * city + 1)
+ */
+static void tour_adjacency(const gene_t *tour, int n, vector<int> &adj)
+{
+	for (int i = 0; i < n; i++)
+	{
+		int c = tour[i];
+		adj[2 * c] = tour[i == 0 ? n - 1 : i - 1];
+		adj[2 * c + 1] = tour[i + 1 == n ? 0 : i + 1];
+	}
+}
+
+static inline bool has_edge(const vector<int> &adj, int u, int v)
+{
+	return adj[2 * u] == v || adj[2 * u + 1] == v;
+}
+
+static inline void remove_half(vector<int> &adj, int u, int v)
+{
+	adj[2 * u + (adj[2 * u] == v ? 0 : 1)] = 0;
+}
+
+static inline void remove_edge(vector<int> &adj, int u, int v)
+{
+	remove_half(adj, u, v);
+	remove_half(adj, v, u);
+}
+
+static inline void add_edge(vector<int> &adj, int u, int v)
+{
+	adj[2 * u + (adj[2 * u] == 0 ? 0 : 1)] = v;
+	adj[2 * v + (adj[2 * v] == 0 ? 0 : 1)] = u;
+}
+
+/**
+ * @brief Edges of <adj> that are not in <other>
+ */
+static void exclusive_edges(const vector<int> &adj, const vector<int> &other, vector<int> &rem, int n)
+{
+	for (int c = 1; c <= n; c++)
+	{
+		for (int s = 0; s < 2; s++)
+		{
+			int v = adj[2 * c + s];
+			rem[2 * c + s] = has_edge(other, c, v) ? 0 : v;
+		}
+	}
+}
+
+/**
+ * @brief Split the edges that only one parent has into AB-cycles, closed paths that alternate an edge of A and an
+ * edge of B
+ *
+ * Every city has as many exclusive edges of A as of B, so an alternating path started with an edge of A can always
+ * be extended until it closes on itself with the right parity. Cycles are stored starting with an edge of A.
+ */
+static void trace_ab_cycles(Rng &rng, Crossover &cx)
+{
+	int n = cx.n;
+	cx.cycles.clear();
+	cx.cycle_start.assign(1, 0);
+
+	int offset = rand_num(rng, 0, n);
+	for (int k = 0; k < n; k++)
+	{
+		int s = (offset + k) % n + 1;
+		while (cx.rem_a[2 * s] || cx.rem_a[2 * s + 1])
+		{
+			cx.path.assign(1, s);
+			cx.at_even[s] = 0;
+			while (true)
+			{
+				int m = cx.path.size() - 1;
+				int cur = cx.path[m];
+				vector<int> &rem = m % 2 == 0 ? cx.rem_a : cx.rem_b;
+				if (!rem[2 * cur] && !rem[2 * cur + 1])
+					break;
+
+				int slot = !rem[2 * cur] ? 1 : !rem[2 * cur + 1] ? 0 : (int)(next_rng(rng) >> 63);
+				int next = rem[2 * cur + slot];
+				remove_edge(rem, cur, next);
+				cx.path.push_back(next);
+
+				int idx = m + 1;
+				vector<int> &at = idx % 2 == 0 ? cx.at_even : cx.at_odd;
+				int j = at[next];
+				if (j < 0)
+				{
+					at[next] = idx;
+					continue;
+				}
+
+				// Closed: path[j ... idx - 1] is an AB-cycle
+				int first = j % 2 == 0 ? j : j + 1;
+				for (int t = first; t < first + idx - j; t++)
+					cx.cycles.push_back(cx.path[t]);
+				cx.cycle_start.push_back(cx.cycles.size());
+
+				for (int t = j + 1; t < idx; t++)
+					(t % 2 == 0 ? cx.at_even : cx.at_odd)[cx.path[t]] = -1;
+				cx.path.resize(j + 1);
+			}
+			for (int t = 0; t < (int)cx.path.size(); t++)
+				(t % 2 == 0 ? cx.at_even : cx.at_odd)[cx.path[t]] = -1;
+		}
+	}
+}
+
+/**
+ * @brief Label the subtours of the intermediate child
+ *
+ * @return number of subtours
+ */
+static int label_subtours(Crossover &cx)
+{
+	int n = cx.n;
+	fill(cx.subtour.begin(), cx.subtour.end(), -1);
+	cx.subtour_size.clear();
+	cx.subtour_city.clear();
+
+	for (int c = 1; c <= n; c++)
+	{
+		if (cx.subtour[c] >= 0)
+			continue;
+		int id = cx.subtour_size.size(), size = 0;
+		int prev = 0, cur = c;
+		do
+		{
+			cx.subtour[cur] = id;
+			size++;
+			int next = cx.child[2 * cur] != prev ? cx.child[2 * cur] : cx.child[2 * cur + 1];
+			prev = cur;
+			cur = next;
+		} while (cur != c);
+		cx.subtour_size.push_back(size);
+		cx.subtour_city.push_back(c);
+	}
+	return cx.subtour_size.size();
+}
+
+/**
+ * @brief Join the subtours of the intermediate child into a tour
+ *
+ * The smallest subtour is joined to another one with the cheapest 2-opt move that removes an edge of each and
+ * reconnects them, the other subtour found among the candidate neighbours of its cities.
+ *
+ * @return length added by the moves
+ */
+static double merge_subtours(int subtours, const Map &tsp, Crossover &cx)
+{
+	int n = cx.n, K = tsp.neighbourK;
+	double added = 0;
+
+	// Min-heap of (size, subtour), entries of merged subtours or of an old size are skipped
+	cx.smallest.clear();
+	for (int s = 0; s < subtours; s++)
+		cx.smallest.push_back(make_pair(cx.subtour_size[s], s));
+	make_heap(cx.smallest.begin(), cx.smallest.end(), greater<pair<int, int>>());
+
+	while (subtours > 1)
+	{
+		pop_heap(cx.smallest.begin(), cx.smallest.end(), greater<pair<int, int>>());
+		int u = cx.smallest.back().second;
+		bool stale = cx.smallest.back().first != cx.subtour_size[u];
+		cx.smallest.pop_back();
+		if (stale)
+			continue;
+
+		cx.members.clear();
+		int prev = 0, cur = cx.subtour_city[u];
+		do
+		{
+			cx.members.push_back(cur);
+			int next = cx.child[2 * cur] != prev ? cx.child[2 * cur] : cx.child[2 * cur + 1];
+			prev = cur;
+			cur = next;
+		} while (cur != cx.subtour_city[u]);
+
+		double best = DBL_MAX;
+		int bc = 0, bc2 = 0, bd = 0, bd2 = 0;
+		auto consider = [&](int c, int d) {
+			double joined = getDistance(tsp, c, d);
+			for (int s = 0; s < 2; s++)
+			{
+				int c2 = cx.child[2 * c + s];
+				double removed = getDistance(tsp, c, c2);
+				for (int t = 0; t < 2; t++)
+				{
+					int d2 = cx.child[2 * d + t];
+					double gain = joined + getDistance(tsp, c2, d2) - removed - getDistance(tsp, d, d2);
+					if (gain < best)
+					{
+						best = gain;
+						bc = c, bc2 = c2, bd = d, bd2 = d2;
+					}
+				}
+			}
+		};
+
+		for (int c : cx.members)
+			for (int k = 0; k < K; k++)
+			{
+				int d = tsp.neighbours[(size_t)c * K + k];
+				if (cx.subtour[d] != u)
+					consider(c, d);
+			}
+
+		if (best == DBL_MAX)
+		{
+			int tried = min((int)cx.members.size(), EAX_FALLBACK_CITIES);
+			for (int m = 0; m < tried; m++)
+				for (int d = 1; d <= n; d++)
+					if (cx.subtour[d] != u)
+						consider(cx.members[m], d);
+		}
+
+		added += best;
+		remove_edge(cx.child, bc, bc2);
+		remove_edge(cx.child, bd, bd2);
+		add_edge(cx.child, bc, bd);
+		add_edge(cx.child, bc2, bd2);
+
+		int target = cx.subtour[bd];
+		for (int c : cx.members)
+			cx.subtour[c] = target;
+		cx.subtour_size[target] += cx.subtour_size[u];
+		cx.subtour_size[u] = 0;
+		cx.smallest.push_back(make_pair(cx.subtour_size[target], target));
+		push_heap(cx.smallest.begin(), cx.smallest.end(), greater<pair<int, int>>());
+		subtours--;
+	}
+	return added;
+}
+
+/**
+ * @brief Edge assembly crossover (EAX, single AB-cycle strategy)
+ *
+ * The edges of both parents are split into AB-cycles. The child starts as the edges of <p1>, swaps the A edges of a
+ * random AB-cycle for its B edges, which breaks it into subtours, and joins the subtours greedily. The child keeps
+ * almost every edge of the parents, only the few edges that join the subtours are new.
+ *
+ * @return fitness delta of the child over <p1>
+ */
+static double edge_assembly_crossover(const gene_t *p1, const gene_t *p2, gene_t *child, const Map &tsp, Rng &rng, Crossover &cx)
+{
+	int n = cx.n;
+	tour_adjacency(p1, n, cx.adj_a);
+	tour_adjacency(p2, n, cx.adj_b);
+	exclusive_edges(cx.adj_a, cx.adj_b, cx.rem_a, n);
+	exclusive_edges(cx.adj_b, cx.adj_a, cx.rem_b, n);
+	trace_ab_cycles(rng, cx);
+
+	int n_cycles = cx.cycle_start.size() - 1;
+	if (n_cycles == 0)
+	{
+		copy(p1, p1 + n, child);
+		return 0;
+	}
+
+	int selected = rand_num(rng, 0, n_cycles);
+	const int *cycle = &cx.cycles[cx.cycle_start[selected]];
+	int length = cx.cycle_start[selected + 1] - cx.cycle_start[selected];
+
+	double delta = 0;
+	cx.child = cx.adj_a;
+	for (int k = 0; k < length; k += 2)
+	{
+		remove_edge(cx.child, cycle[k], cycle[k + 1]);
+		delta -= getDistance(tsp, cycle[k], cycle[k + 1]);
+	}
+	for (int k = 1; k < length; k += 2)
+	{
+		int next = cycle[k + 1 == length ? 0 : k + 1];
+		add_edge(cx.child, cycle[k], next);
+		delta += getDistance(tsp, cycle[k], next);
+	}
+
+	delta += merge_subtours(label_subtours(cx), tsp, cx);
+
+	int prev = 0, cur = p1[0];
+	for (int i = 0; i < n; i++)
+	{
+		child[i] = cur;
+		int next = cx.child[2 * cur] != prev ? cx.child[2 * cur] : cx.child[2 * cur + 1];
+		prev = cur;
+		cur = next;
+	}
+	return delta;
+}
+
+/**
+ * @brief Build a child combining the gnomes <p1> and <p2>
+ *
+ * EAX needs the candidate neighbours of the problem and a symmetric problem.
+ *
+ * @param op crossover operator
+ * @param p1 first parent
+ * @param p2 second parent
+ * @param child where to write the child (not one of the parents)
+ * @param tsp TSP problem object
+ * @param rng random number generator of the calling thread
+ * @param cx crossover scratch memory of the calling thread
+ * @return fitness delta of the child over <p1> (EAX), NAN if the child has to be evaluated (OX, PMX)
+ */
+double crossover(CrossoverOperator op, const gene_t *p1, const gene_t *p2, gene_t *child, const Map &tsp, Rng &rng, Crossover &cx)
+{
+	PROFILE_SCOPE(PHASE_CROSSOVER);
+
+	// Tours of less than 5 cities have no AB-cycle that changes them
+	if (op == CROSSOVER_EAX && cx.n >= 5)
+		return edge_assembly_crossover(p1, p2, child, tsp, rng, cx);
+
+	if (op == CROSSOVER_PMX)
+		partially_mapped_crossover(p1, p2, child, rng, cx);
+	else if (op == CROSSOVER_OX)
+		order_crossover(p1, p2, child, rng, cx);
+	else
+	{
+		copy(p1, p1 + cx.n, child);
+		return 0;
+	}
+	return NAN;
+}
@@ -0,0 +1,48 @@
+/**
+ * @file crossover.h
+ * @author Javier Vela
+ * @brief Header file of the crossover operators (OX, PMX, EAX) that combine two gnomes of the Genetic Algorithm
+ * @version 0.1
+ * @date 2021-12-30
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef CROSSOVER_H
+#define CROSSOVER_H
+
+#include <vector>
+#include "tsplib.h"
+#include "population.h"
+#include "random.h"
+
+/// Cities of the smallest subtour whose connection to the other subtours is searched among all cities when none of
+/// their candidate neighbours lies outside it (EAX)
+#ifndef EAX_FALLBACK_CITIES
+#define EAX_FALLBACK_CITIES 16
+#endif
+
+/// Scratch memory of the crossover operators, one per thread so several children are built concurrently
+struct Crossover
+{
+	int n;                          // Cities of the tours
+	std::vector<int> pos;           // Position of every city in the child (PMX), -1 for the cities of the segment (OX)
+	std::vector<int> adj_a, adj_b;  // Two neighbours of every city in each parent (EAX)
+	std::vector<int> rem_a, rem_b;  // Edges of each parent not in the other one and not yet in an AB-cycle
+	std::vector<int> child;         // Two neighbours of every city in the intermediate child
+	std::vector<int> path;          // Alternating path being traced
+	std::vector<int> at_even, at_odd; // Position of every city in the path, by parity (-1 if not in it)
+	std::vector<int> cycles;        // Cities of all AB-cycles, one after the other
+	std::vector<int> cycle_start;   // Start of every AB-cycle in cycles (and its end)
+	std::vector<int> subtour;       // Subtour of every city in the intermediate child
+	std::vector<int> subtour_size;  // Cities of every subtour (0 once merged)
+	std::vector<int> subtour_city;  // A city of every subtour
+	std::vector<int> members;       // Cities of the subtour being merged
+	std::vector<std::pair<int, int>> smallest; // Subtours by size
+};
+
+void init_crossover(Crossover &cx, int dimension);
+double crossover(CrossoverOperator op, const gene_t *p1, const gene_t *p2, gene_t *child, const Map &tsp, Rng &rng, Crossover &cx);
+
+#endif /* CROSSOVER_H */
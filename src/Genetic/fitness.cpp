@@ -0,0 +1,395 @@
+/**
+ * @file fitness.cpp
+ * @author Javier Vela
+ * @brief Source file of the fitness evaluation of gnomes, one at a time or in SIMD batches
+ * @version 0.1
+ * @date 2021-12-29
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <immintrin.h>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <iostream>
+#include <type_traits>
+#include "fitness.h"
+#include "distance.h"
+#include "profiler.h"
+#include "omp.h"
+
+using namespace std;
+
+/// Gnomes evaluated by each task of a batch
+#define FITNESS_GROUP 16
+
+/*
+ * Every lane of a vector walks the tour of a different gnome, adding its edges in the same order and with the same
+ * conversions (distance to float, sum in double) as calculate_fitness, so the fitness is the same bit for bit. This
+ * file is compiled with -ffp-contract=off, multiplications and additions of coordinates are never fused.
+ */
+
+/* AVX2 */
+
+/// Distances of 8 pairs of cities gathered from a dense matrix
+template <typename T, MatrixLayout L>
+struct MatrixAvx2
+{
+	DistanceMatrix<T, L> matrix;
+
+	__attribute__((target("avx2"))) inline __m256 operator()(__m256i a, __m256i b) const
+	{
+		__m256i index;
+		if (L == MATRIX_FULL)
+		{
+			index = _mm256_add_epi32(_mm256_mullo_epi32(a, _mm256_set1_epi32(matrix.n + 1)), b);
+		}
+		else
+		{
+			__m256i r = _mm256_max_epi32(a, b), c = _mm256_min_epi32(a, b);
+			__m256i triangle = _mm256_mullo_epi32(r, _mm256_add_epi32(r, _mm256_set1_epi32(1)));
+			index = _mm256_add_epi32(_mm256_srli_epi32(triangle, 1), c);
+		}
+
+		if (is_same<T, float>::value)
+			return _mm256_i32gather_ps((const float *)matrix.data, index, 4);
+		if (is_same<T, int32_t>::value)
+			return _mm256_cvtepi32_ps(_mm256_i32gather_epi32((const int *)matrix.data, index, 4));
+		// 16-bit cells are the high half of the 32 bits that end at them (cell 0 is never read)
+		__m256i cells = _mm256_i32gather_epi32((const int *)((const uint16_t *)matrix.data - 1), index, 2);
+		return _mm256_cvtepi32_ps(_mm256_srli_epi32(cells, 16));
+	}
+};
+
+/// Distances of 8 pairs of cities computed from their coordinates (EUC_2D, or CEIL_2D if CEIL)
+template <bool CEIL>
+struct CoordinatesAvx2
+{
+	const double *x, *y;
+
+	__attribute__((target("avx2"))) inline __m128 half(__m128i a, __m128i b) const
+	{
+		__m256d dx = _mm256_sub_pd(_mm256_i32gather_pd(x, a, 8), _mm256_i32gather_pd(x, b, 8));
+		__m256d dy = _mm256_sub_pd(_mm256_i32gather_pd(y, a, 8), _mm256_i32gather_pd(y, b, 8));
+		__m256d d = _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)));
+		if (CEIL)
+			return _mm256_cvtpd_ps(_mm256_ceil_pd(d));
+		return _mm_cvtepi32_ps(_mm256_cvttpd_epi32(_mm256_add_pd(d, _mm256_set1_pd(0.5))));
+	}
+
+	__attribute__((target("avx2"))) inline __m256 operator()(__m256i a, __m256i b) const
+	{
+		__m128 lo = half(_mm256_castsi256_si128(a), _mm256_castsi256_si128(b));
+		__m128 hi = half(_mm256_extracti128_si256(a, 1), _mm256_extracti128_si256(b, 1));
+		return _mm256_set_m128(hi, lo);
+	}
+};
+
+/**
+ * @brief Genes at positions <i> ... <i> + 7 of the gnomes <lanes>, one vector per position (8 x 8 transpose)
+ *
+ * Gathering the genes of every position would take as many gathers as distances, the rows of 8 genes are loaded
+ * instead and transposed.
+ */
+__attribute__((target("avx2"))) static inline void gene_block_avx2(const gene_t *const *lanes, int i, __m256i *block)
+{
+	__m256i r[8], t[8];
+	for (int l = 0; l < 8; l++)
+	{
+		if (sizeof(gene_t) == sizeof(int32_t))
+			r[l] = _mm256_loadu_si256((const __m256i *)(lanes[l] + i));
+		else
+			r[l] = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(lanes[l] + i)));
+	}
+	for (int l = 0; l < 8; l += 2)
+	{
+		t[l] = _mm256_unpacklo_epi32(r[l], r[l + 1]);
+		t[l + 1] = _mm256_unpackhi_epi32(r[l], r[l + 1]);
+	}
+	for (int l = 0; l < 8; l += 4)
+	{
+		r[l] = _mm256_unpacklo_epi64(t[l], t[l + 2]);
+		r[l + 1] = _mm256_unpackhi_epi64(t[l], t[l + 2]);
+		r[l + 2] = _mm256_unpacklo_epi64(t[l + 1], t[l + 3]);
+		r[l + 3] = _mm256_unpackhi_epi64(t[l + 1], t[l + 3]);
+	}
+	for (int l = 0; l < 4; l++)
+	{
+		block[l] = _mm256_permute2x128_si256(r[l], r[l + 4], 0x20);
+		block[l + 4] = _mm256_permute2x128_si256(r[l], r[l + 4], 0x31);
+	}
+}
+
+/**
+ * @brief Genes at position <i> of the gnomes <lanes>
+ */
+__attribute__((target("avx2"))) static inline __m256i gene_column_avx2(const gene_t *const *lanes, int i)
+{
+	int column[8];
+	for (int l = 0; l < 8; l++)
+		column[l] = lanes[l][i];
+	return _mm256_loadu_si256((const __m256i *)column);
+}
+
+/// Tours of 8 gnomes walked together
+struct ToursAvx2
+{
+	__m256i previous;       // Last city of every tour
+	__m256d sum_lo, sum_hi; // Length so far of tours 0-3 and 4-7
+	__m256 infinite;        // Tours with an INT_MAX edge
+};
+
+/**
+ * @brief Add to the tours the edges from their last cities to <city>
+ */
+template <class Distances>
+__attribute__((target("avx2"))) static inline void walk_avx2(ToursAvx2 &tours, __m256i city, const Distances &distances)
+{
+	__m256 d = distances(tours.previous, city);
+	tours.infinite = _mm256_or_ps(tours.infinite, _mm256_cmp_ps(d, _mm256_set1_ps(INT_MAX), _CMP_EQ_OQ));
+	tours.sum_lo = _mm256_add_pd(tours.sum_lo, _mm256_cvtps_pd(_mm256_castps256_ps128(d)));
+	tours.sum_hi = _mm256_add_pd(tours.sum_hi, _mm256_cvtps_pd(_mm256_extractf128_ps(d, 1)));
+	tours.previous = city;
+}
+
+/**
+ * @brief Fitness of the <count> (up to 8) gnomes <lanes>
+ */
+template <class Distances>
+__attribute__((target("avx2"))) static void fitness_avx2(const gene_t *const *lanes, int count, int V, const Distances &distances, float *fitness)
+{
+	__m256i first = gene_column_avx2(lanes, 0);
+	ToursAvx2 tours = {first, _mm256_setzero_pd(), _mm256_setzero_pd(), _mm256_setzero_ps()};
+
+	__m256i block[8];
+	int i = 1;
+	for (; i + 8 <= V; i += 8)
+	{
+		gene_block_avx2(lanes, i, block);
+		for (int b = 0; b < 8; b++)
+			walk_avx2(tours, block[b], distances);
+	}
+	for (; i < V; i++)
+		walk_avx2(tours, gene_column_avx2(lanes, i), distances);
+	walk_avx2(tours, first, distances);
+
+	__m256 f = _mm256_set_m128(_mm256_cvtpd_ps(tours.sum_hi), _mm256_cvtpd_ps(tours.sum_lo));
+	float lanes_fitness[8];
+	_mm256_storeu_ps(lanes_fitness, _mm256_blendv_ps(f, _mm256_set1_ps(INT_MAX), tours.infinite));
+	memcpy(fitness, lanes_fitness, count * sizeof(float));
+}
+
+/* AVX-512 */
+
+/// Distances of 16 pairs of cities gathered from a dense matrix
+template <typename T, MatrixLayout L>
+struct MatrixAvx512
+{
+	DistanceMatrix<T, L> matrix;
+
+	__attribute__((target("avx512f"))) inline __m512 operator()(__m512i a, __m512i b) const
+	{
+		__m512i index;
+		if (L == MATRIX_FULL)
+		{
+			index = _mm512_add_epi32(_mm512_mullo_epi32(a, _mm512_set1_epi32(matrix.n + 1)), b);
+		}
+		else
+		{
+			__m512i r = _mm512_max_epi32(a, b), c = _mm512_min_epi32(a, b);
+			__m512i triangle = _mm512_mullo_epi32(r, _mm512_add_epi32(r, _mm512_set1_epi32(1)));
+			index = _mm512_add_epi32(_mm512_srli_epi32(triangle, 1), c);
+		}
+
+		if (is_same<T, float>::value)
+			return _mm512_i32gather_ps(index, matrix.data, 4);
+		if (is_same<T, int32_t>::value)
+			return _mm512_cvtepi32_ps(_mm512_i32gather_epi32(index, matrix.data, 4));
+		__m512i cells = _mm512_i32gather_epi32(index, (const uint16_t *)matrix.data - 1, 2);
+		return _mm512_cvtepi32_ps(_mm512_srli_epi32(cells, 16));
+	}
+};
+
+__attribute__((target("avx512f"))) static inline __m512i join_avx512(__m256i lo, __m256i hi)
+{
+	return _mm512_inserti64x4(_mm512_castsi256_si512(lo), hi, 1);
+}
+
+/// Tours of 16 gnomes walked together
+struct ToursAvx512
+{
+	__m512i previous;
+	__m512d sum_lo, sum_hi;
+	__mmask16 infinite;
+};
+
+template <class Distances>
+__attribute__((target("avx512f"))) static inline void walk_avx512(ToursAvx512 &tours, __m512i city, const Distances &distances)
+{
+	__m512 d = distances(tours.previous, city);
+	tours.infinite |= _mm512_cmp_ps_mask(d, _mm512_set1_ps(INT_MAX), _CMP_EQ_OQ);
+	__m512d bits = _mm512_castps_pd(d);
+	tours.sum_lo = _mm512_add_pd(tours.sum_lo, _mm512_cvtps_pd(_mm256_castpd_ps(_mm512_castpd512_pd256(bits))));
+	tours.sum_hi = _mm512_add_pd(tours.sum_hi, _mm512_cvtps_pd(_mm256_castpd_ps(_mm512_extractf64x4_pd(bits, 1))));
+	tours.previous = city;
+}
+
+/**
+ * @brief Fitness of the <count> (up to 16) gnomes <lanes>, the genes of lanes 0-7 and 8-15 transposed with AVX2
+ */
+template <class Distances>
+__attribute__((target("avx512f,avx2"))) static void fitness_avx512(const gene_t *const *lanes, int count, int V, const Distances &distances, float *fitness)
+{
+	__m512i first = join_avx512(gene_column_avx2(lanes, 0), gene_column_avx2(lanes + 8, 0));
+	ToursAvx512 tours = {first, _mm512_setzero_pd(), _mm512_setzero_pd(), 0};
+
+	__m256i lo[8], hi[8];
+	int i = 1;
+	for (; i + 8 <= V; i += 8)
+	{
+		gene_block_avx2(lanes, i, lo);
+		gene_block_avx2(lanes + 8, i, hi);
+		for (int b = 0; b < 8; b++)
+			walk_avx512(tours, join_avx512(lo[b], hi[b]), distances);
+	}
+	for (; i < V; i++)
+		walk_avx512(tours, join_avx512(gene_column_avx2(lanes, i), gene_column_avx2(lanes + 8, i)), distances);
+	walk_avx512(tours, first, distances);
+
+	__m512d f = _mm512_castpd256_pd512(_mm256_castps_pd(_mm512_cvtpd_ps(tours.sum_lo)));
+	f = _mm512_insertf64x4(f, _mm256_castps_pd(_mm512_cvtpd_ps(tours.sum_hi)), 1);
+	float lanes_fitness[16];
+	_mm512_storeu_ps(lanes_fitness, _mm512_mask_blend_ps(tours.infinite, _mm512_castpd_ps(f), _mm512_set1_ps(INT_MAX)));
+	memcpy(fitness, lanes_fitness, count * sizeof(float));
+}
+
+/* Dispatch */
+
+/**
+ * @brief Widest instruction set of the processor, checked once
+ */
+static FitnessKernel processor_kernel()
+{
+	static const FitnessKernel kernel = []() {
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f"))
+			return FITNESS_AVX512;
+		if (__builtin_cpu_supports("avx2"))
+			return FITNESS_AVX2;
+		return FITNESS_SCALAR;
+	}();
+	return kernel;
+}
+
+/**
+ * @brief Kernel batch_fitness uses for a problem
+ *
+ * Dense matrices are gathered with the widest instruction set of the processor, as long as their cells are indexed
+ * with 32 bits. EUC_2D and CEIL_2D distances without matrix are computed with AVX2. Other problems are evaluated one
+ * gnome at a time.
+ */
+FitnessKernel fitness_kernel(const Map &tsp)
+{
+	FitnessKernel kernel = processor_kernel();
+	if (tsp.backend == DENSE_MATRIX)
+		return matrixBytes(tsp.matrixElement, tsp.matrixLayout, tsp.dimension) <= INT32_MAX ? kernel : FITNESS_SCALAR;
+	if (tsp.edgeWeightType == EUC_2D || tsp.edgeWeightType == CEIL_2D)
+		return kernel == FITNESS_SCALAR ? FITNESS_SCALAR : FITNESS_AVX2;
+	return FITNESS_SCALAR;
+}
+
+/**
+ * @brief Fitness of the <count> (up to FITNESS_GROUP) individuals of <population> from <at>
+ */
+static void evaluate_group(FitnessKernel kernel, Population &population, int at, int count, const Map &tsp)
+{
+	int V = tsp.dimension;
+	float *fitness = &population.fitness[at];
+
+	// Missing lanes repeat the first gnome, their fitness is dropped
+	const gene_t *lanes[FITNESS_GROUP];
+	for (int l = 0; l < FITNESS_GROUP; l++)
+		lanes[l] = gnome(population, l < count ? at + l : at);
+
+	if (kernel == FITNESS_AVX512)
+	{
+		withMatrix(tsp.matrixElement, tsp.matrixLayout, tsp.matrix, V, [&](auto matrix) {
+			MatrixAvx512<typename decltype(matrix)::element_type, decltype(matrix)::layout> distances = {matrix};
+			fitness_avx512(lanes, count, V, distances, fitness);
+		});
+	}
+	else if (kernel == FITNESS_AVX2)
+	{
+		for (int l = 0; l < count; l += 8)
+		{
+			int n = min(8, count - l);
+			if (tsp.backend == DENSE_MATRIX)
+			{
+				withMatrix(tsp.matrixElement, tsp.matrixLayout, tsp.matrix, V, [&](auto matrix) {
+					MatrixAvx2<typename decltype(matrix)::element_type, decltype(matrix)::layout> distances = {matrix};
+					fitness_avx2(lanes + l, n, V, distances, fitness + l);
+				});
+			}
+			else if (tsp.edgeWeightType == CEIL_2D)
+			{
+				CoordinatesAvx2<true> distances = {tsp.x, tsp.y};
+				fitness_avx2(lanes + l, n, V, distances, fitness + l);
+			}
+			else
+			{
+				CoordinatesAvx2<false> distances = {tsp.x, tsp.y};
+				fitness_avx2(lanes + l, n, V, distances, fitness + l);
+			}
+		}
+	}
+	else
+	{
+		withDistances(tsp, [&](const auto &distances) {
+			for (int l = 0; l < count; l++)
+				fitness[l] = calculate_fitness(lanes[l], V, distances);
+		});
+	}
+}
+
+/**
+ * @brief Compute the fitness of the individuals <first> ... <first> + <count> - 1 of <population>
+ *
+ * Groups of gnomes are spread over the OpenMP threads, each group evaluated by the kernel of fitness_kernel. The
+ * fitness is exactly the one calculate_fitness gives.
+ *
+ * @param population population
+ * @param first first individual to evaluate
+ * @param count number of individuals to evaluate
+ * @param tsp TSP problem object
+ */
+void batch_fitness(Population &population, int first, int count, const Map &tsp)
+{
+	PROFILE_SCOPE(PHASE_EVALUATION);
+	PROFILE_COUNT(COUNTER_EVALUATIONS, count);
+	FitnessKernel kernel = fitness_kernel(tsp);
+	int groups = (count + FITNESS_GROUP - 1) / FITNESS_GROUP;
+
+#pragma omp parallel for schedule(dynamic, 1)
+	for (int g = 0; g < groups; g++)
+	{
+		int at = first + g * FITNESS_GROUP;
+		evaluate_group(kernel, population, at, min(FITNESS_GROUP, first + count - at), tsp);
+	}
+
+	if (CHECK_FITNESS)
+	{
+		withDistances(tsp, [&](const auto &distances) {
+			for (int i = first; i < first + count; i++)
+			{
+				float scalar = calculate_fitness(gnome(population, i), tsp.dimension, distances);
+				if (memcmp(&scalar, &population.fitness[i], sizeof(float)) != 0)
+				{
+					cerr << "Error : batch fitness " << population.fitness[i] << " of individual " << i << " does not match scalar fitness " << scalar << endl;
+					break;
+				}
+			}
+		});
+	}
+}
@@ -0,0 +1,73 @@
+/**
+ * @file fitness.h
+ * @author Javier Vela
+ * @brief Header file of the fitness evaluation of gnomes, one at a time or in SIMD batches
+ * @version 0.1
+ * @date 2021-12-29
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef FITNESS_H
+#define FITNESS_H
+
+#include <limits.h>
+#include "tsplib.h"
+#include "population.h"
+
+/// Compare every fitness of a batch with the scalar evaluation of the gnome (debug)
+#ifndef CHECK_FITNESS
+#define CHECK_FITNESS 0
+#endif
+
+/// Instruction set of the batch fitness evaluation
+enum FitnessKernel
+{
+	FITNESS_SCALAR,
+	FITNESS_AVX2,  // 8 gnomes at a time
+	FITNESS_AVX512 // 16 gnomes at a time
+};
+
+/**
+ * @brief Length of the edge leaving position <i> of the closed tour <gnome>
+ *
+ * @param gnome tour
+ * @param V size of map (genes in the gnome)
+ * @param i position of the edge in the tour
+ * @param distances distances of the problem (see withDistances)
+ * @return distance between gnome[i] and the city that follows it
+ */
+template <class Distances>
+inline float edge_length(const gene_t *gnome, int V, int i, const Distances &distances)
+{
+	int next = i + 1 == V ? 0 : i + 1;
+	return distances(gnome[i], gnome[next]);
+}
+
+/**
+ * @brief Function to return the fitness value of a gnome.
+ *
+ * @param gnome Gnome to be evaluated
+ * @param V size of map (genes in the gnome)
+ * @param distances distances of the problem (see withDistances)
+ * @return The fitness value is the length of the closed tour represented by the GNOME.
+ */
+template <class Distances>
+float calculate_fitness(const gene_t *gnome, int V, const Distances &distances)
+{
+	double f = 0;
+	for (int i = 0; i < V; i++)
+	{
+		float d = edge_length(gnome, V, i, distances);
+		if (d == INT_MAX)
+			return INT_MAX;
+		f += d;
+	}
+	return f;
+}
+
+FitnessKernel fitness_kernel(const Map &tsp);
+void batch_fitness(Population &population, int first, int count, const Map &tsp);
+
+#endif /* FITNESS_H */
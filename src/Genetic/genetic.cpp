@@ -15,7 +15,24 @@
 #include <iostream>
 #include <algorithm>
 #include <chrono>
+#include <thread>
+#include <atomic>
+#include <sstream>
 #include "genetic.h"
+#include "distance.h"
+#include "random.h"
+#include "localsearch.h"
+#include "seeding.h"
+#include "migration.h"
+#include "codec.h"
+#include "fitness.h"
+#include "crossover.h"
+#include "steady.h"
+#include "profiler.h"
+#include "telemetry.h"
+#include "checkpoint.h"
+#include "bound.h"
+#include "tourhash.h"
 #include "omp.h"
 #include "mpi.h"
 
@@ -23,242 +40,510 @@ using namespace std;
 using namespace std::chrono;
 
 /**
- * @brief Serialize <first_n> individuals of <population> into 2 vectors
- * 
- * @param population population to serialize
- * @param first_n number of individuals to serialize
- * @param gnome_v vector of integers where to serialize gnome of individuals
- * @param fitness_v vector of float where to serialize fitness of individuals
+ * @brief Function to mutate a GNOME in place, interchanging two random genes to create variation in species
+ *
+ * Only the (up to four) edges around the swapped positions change, so the fitness variation is computed in O(1)
+ *
+ * @param gnome gnome to mutate
+ * @param V size of map (genes in the gnome)
+ * @param distances distances of the problem (see withDistances)
+ * @param rng random number generator of the calling thread
+ * @param touched if not NULL, where to write the two swapped cities
+ * @param hash if not NULL, tour hash of the gnome updated with the keys of the edges that change (see tour_hash)
+ * @param keys keys of the cities of the hash
+ * @return fitness delta of the mutation (fitness after minus fitness before)
  */
-void serialize_population(std::vector<individual> &population, int first_n, int *gnome_v, float *fitness_v, int size_gnome)
+template <class Distances>
+float mutate_gnome(gene_t *gnome, int V, const Distances &distances, Rng &rng, int thread_id, int thread_total, gene_t *touched = NULL, uint64_t *hash = NULL, const TourKeys *keys = NULL)
 {
-	int n = 1;
-	int g_v_i = 0;
-	int f_v_i = 0;
+	int begin = (V * thread_id) / thread_total + 1;
+	int end = ((V * (thread_id + 1)) / thread_total);
 
-	for (auto indi : population)
+	// Less than two genes to swap (problems of two cities), the gnome stays as it is
+	if (end - begin < 2)
 	{
-		//cout << "FIRST: " << first_n << " " << g_v_i << " " << f_v_i << endl;
+		if (touched != NULL)
+			touched[0] = touched[1] = gnome[0];
+		return 0;
+	}
 
-		fitness_v[f_v_i++] = indi.fitness;
-		for (auto city : indi.gnome)
-		{
-			//cout << " city " << city;
-			gnome_v[g_v_i++] = city;
-		}
+	int r, r1;
+	do
+	{
+		r = rand_num(rng, begin, end);
+		r1 = rand_num(rng, begin, end);
+	} while (r1 == r);
+
+	// Edges leaving positions r - 1, r, r1 - 1 and r1 (without repeating edges of adjacent positions)
+	int edges[4] = {r - 1, r, r1 - 1, r1};
+	int n_edges = 0;
+	for (int e : edges)
+	{
+		if (e < 0)
+			e += V;
+		if (find(edges, edges + n_edges, e) == edges + n_edges)
+			edges[n_edges++] = e;
+	}
 
-		// Only do <first_n> individuals in population
-		if (n == first_n)
-			break;
+	double delta = 0;
+	for (int e = 0; e < n_edges; e++)
+		delta -= edge_length(gnome, V, edges[e], distances);
+	if (hash)
+	{
+		for (int e = 0; e < n_edges; e++)
+			*hash ^= edge_hash(*keys, gnome[edges[e]], gnome[edges[e] + 1 == V ? 0 : edges[e] + 1]);
+	}
+
+	gene_t temp = gnome[r];
+	gnome[r] = gnome[r1];
+	gnome[r1] = temp;
+
+	for (int e = 0; e < n_edges; e++)
+		delta += edge_length(gnome, V, edges[e], distances);
+	if (hash)
+	{
+		for (int e = 0; e < n_edges; e++)
+			*hash ^= edge_hash(*keys, gnome[edges[e]], gnome[edges[e] + 1 == V ? 0 : edges[e] + 1]);
+	}
 
-		//cout << "n: " << n << endl;
-		n++;
+	if (touched)
+	{
+		touched[0] = gnome[r];
+		touched[1] = gnome[r1];
 	}
+
+	return delta;
 }
 
 /**
- * @brief Deserialize <n> individuals from 2 vectors into <population>
- * 
- * @param population population
- * @param n number of indiiduals to deserialize
- * @param gnome_v vector of integers to deserialize from gnome of individuals
- * @param fitness_v vector of float to deserialize from fitness of individuals
+ * @brief Function to create a valid GNOME required to create the population
+ *
+ * @param gnome where to write the gnome
+ * @param V size of map
+ * @param rng random number generator of the calling thread
  */
-void deserialize_population(std::vector<individual> &population, int n, int *gnome_v, float *fitness_v, int size_gnome)
+void create_gnome(gene_t *gnome, int V, int initial, Rng &rng)
 {
-	//population.clear();
-
-	int g_v_i = 0;
-	int f_v_i = 0;
+	for (int i = 1; i <= V; i++)
+	{
+		gnome[i - 1] = i;
+	}
 
-	// Deserialize vectors
-	for (int indi_i = 0; indi_i < n; indi_i++)
+	// Fisher-Yates shuffle
+	for (int i = V - 1; i > 0; i--)
 	{
-		individual aux_ind;
-		aux_ind.fitness = fitness_v[f_v_i++];
-		for (int city_i = 0; city_i < size_gnome; city_i++)
-		{
-			aux_ind.gnome.push_back(gnome_v[g_v_i++]);
-		}
-		population.push_back(aux_ind);
+		int j = rand_num(rng, 0, i + 1);
+		gene_t temp = gnome[i];
+		gnome[i] = gnome[j];
+		gnome[j] = temp;
 	}
 }
 
 /**
- * @brief Function to return a random number from start and end
+ * @brief Print Population (fitness and gnome) of a certain generation
  *
- * @param start lower limit
- * @param end upper limit
- * @return random integer
+ * @param gen Generation number
+ * @param population Population, EXPECTED to be sorted
  */
-int rand_num(int start, int end)
+void print_generation(int gen, Population &population)
 {
-	int r = end - start;
-	int rnum = start + rand() % r;
-	return rnum;
+	cout << "Generation " << gen << " \n";
+	cout << "GNOME	 FITNESS VALUE\n";
+
+	for (int i = 0; i < population.size; i++)
+	{
+		int indi = population.order[i];
+		const gene_t *g = gnome(population, indi);
+		for (int c = 0; c < population.length; c++)
+			cout << g[c] << ",";
+		cout << " " << population.fitness[indi] << endl;
+	}
 }
 
 /**
- * @brief Function to return a mutated GNOME
+ * @brief Print gnome with best fitness in the population for a certain generation, Login levels control verbosity of output
  *
- * @param gnome initial gnome
- * @param V size of map
- * @return Mutated GNOME is a string with a random interchange of two genes to create variation in species
+ * Lines end without flushing, the stream is flushed when its buffer fills or the program ends.
+ *
+ * @param gen Generation number (negative for the final population)
+ * @param population Population, EXPECTED to be sorted
+ * @param oss output stream
+ * @param log_level verbosity (see Options::LOG_LEVEL)
  */
-std::vector<int> mutate_gnome(std::vector<int> gnome, int V, int thread_id, int thread_total)
+void print_best_gnome(int gen, int mpi_rank, Population &population, std::ostream &oss, int log_level)
 {
-	int begin = (V * thread_id) / thread_total + 1;
-	int end = ((V * (thread_id + 1)) / thread_total);
-	bool mutated = false;
-
-	while (!mutated)
+	PROFILE_SCOPE(PHASE_LOGGING);
+	bool FINAL = gen < 0;
+	int best = population.order[0];
+	const gene_t *best_gnome = gnome(population, best);
+	if (FINAL && log_level > 1)
 	{
-		int r = rand_num(begin, end);
-		int r1 = rand_num(begin, end);
-		if (r1 != r)
-		{
-			int temp = gnome[r];
-			gnome[r] = gnome[r1];
-			gnome[r1] = temp;
+		oss << "Generation FINAL \n";
+		oss << "BEST GNOME	 FITNESS VALUE\n";
+		for (int c = 0; c < population.length; c++)
+			oss << best_gnome[c] << ",";
+		oss << " " << population.fitness[best] << "\n";
+	}
+	else if (!FINAL && log_level > 0)
+	{
+		oss << mpi_rank << "-" << gen << "          " << population.fitness[best] << "\n";
+	}
+	else if (!FINAL && log_level > 1)
+	{
+		oss << "Generation " << gen << " \n";
 
-			mutated = true;
-		}
+		oss << "BEST GNOME	 FITNESS VALUE\n";
+
+		for (int c = 0; c < population.length; c++)
+			oss << best_gnome[c] << ",";
+
+		oss << " " << population.fitness[best] << endl;
 	}
-	return gnome;
 }
 
+/// Buffers of the synchronization of the populations of all nodes (SYNC_BATCH)
+struct Synchronization
+{
+	TourCodec codec; // Tours encoded against the fittest of the last synchronization
+	vector<uint8_t> send_buffer, receive_buffer;
+	vector<int> received_bytes, displacements;
+	Population gathered; // Individuals of all nodes (root)
+	Population snapshot; // Outgoing copy of the population, bred on while it is sent (OVERLAP)
+	Population incoming; // Population received, merged at the next batch boundary (OVERLAP)
+	thread communication; // Thread running the synchronization (OVERLAP)
+	MPI_Comm comm;        // Nodes that synchronize
+	atomic<long long> bytes_sent{0}; // Bytes of all synchronizations sent by the node
+};
+
 /**
- * @brief Function to return a valid GNOME string required to create the population
+ * @brief Share the best individuals of all nodes: root gathers every population, sorts them and broadcasts the fittest
  *
- * @param V size of map
- * @return valid GNOME string
+ * @param sync synchronization buffers
+ * @param population population to send, EXPECTED to be sorted
+ * @param result where to decode the fittest individuals of all nodes (may be population)
+ * @param node_size individuals sent by the node and kept in result
+ * @param population_size individuals of all nodes
  */
-std::vector<int> create_gnome(int V, int initial)
+static void synchronize_populations(Synchronization &sync, Population &population, Population &result, int node_size, int population_size, bool deterministic, int mpi_rank, int mpi_size, int mpi_root)
 {
-	std::vector<int> gnome;
+	int length = population.length;
+	sync.send_buffer.clear();
+	encode_population(sync.codec, population, node_size, sync.send_buffer);
+	int bytes = sync.send_buffer.size();
+	sync.bytes_sent += bytes;
 
-	for (int i = 1; i <= V; i++)
 	{
-		gnome.push_back(i);
+		PROFILE_SCOPE(PHASE_MPI);
+		MPI_Gather(&bytes, 1, MPI_INT, sync.received_bytes.data(), 1, MPI_INT, mpi_root, sync.comm);
+
+		if (mpi_rank == mpi_root)
+		{
+			for (int r = 1; r < mpi_size; r++)
+				sync.displacements[r] = sync.displacements[r - 1] + sync.received_bytes[r - 1];
+			sync.receive_buffer.resize(sync.displacements[mpi_size - 1] + sync.received_bytes[mpi_size - 1]);
+		}
+
+		MPI_Gatherv(sync.send_buffer.data(), bytes, MPI_BYTE, sync.receive_buffer.data(), sync.received_bytes.data(), sync.displacements.data(), MPI_BYTE, mpi_root, sync.comm);
 	}
 
-	random_shuffle(gnome.begin(), gnome.end());
+	if (mpi_rank == mpi_root)
+	{
+		resize_population(sync.gathered, population_size, length);
+		int size = 0;
+		for (int r = 0; r < mpi_size; r++)
+			size += decode_population(sync.codec, &sync.receive_buffer[sync.displacements[r]], sync.gathered, size, population_size - size);
+		sync.gathered.size = size;
+
+		sort_population(sync.gathered, deterministic);
+
+		sync.send_buffer.clear();
+		encode_population(sync.codec, sync.gathered, node_size, sync.send_buffer);
+		bytes = sync.send_buffer.size();
+		sync.bytes_sent += (long long)bytes * (mpi_size - 1);
+	}
 
-	// gnome.push_back(gnome[0]);
+	{
+		PROFILE_SCOPE(PHASE_MPI);
+		MPI_Bcast(&bytes, 1, MPI_INT, mpi_root, sync.comm);
+		sync.send_buffer.resize(bytes);
+		MPI_Bcast(sync.send_buffer.data(), bytes, MPI_BYTE, mpi_root, sync.comm);
+	}
 
-	return gnome;
+	// Root sends its own population size, the biggest, every node keeps as many as it had
+	resize_population(result, node_size, length);
+	result.size = decode_population(sync.codec, sync.send_buffer.data(), result, 0, node_size);
+	set_codec_reference(sync.codec, gnome(result, 0));
+	sort_population(result, deterministic);
 }
 
+/// Rules that stop the run before NUMBER_GENERATIONS, checked by all nodes together after each batch
+struct Stopping
+{
+	bool enabled;
+	double gap;        // Percent above the lower bound, negative never
+	int stall;         // Batches without a fitter tour, 0 never
+	double time_limit; // Seconds, 0 never
+	double bound;      // Lower bound of the optimal tour (gap)
+	float best;        // Fittest tour of all nodes so far
+	int stalled;       // Batches since it was found
+};
+
 /**
- * @brief Function to return the fitness value of a gnome.
+ * @brief Whether the run stops after this batch
  *
- * @param gnome Gnome to be evaluated
- * @param tsp TSP problem object
- * @return The fitness value is the path length of the path represented by the GNOME.
+ * A single reduction gives every node the fittest tour of all nodes and the longest time since the start, so all of
+ * them take the same decision.
+ *
+ * @param seconds time of the node since the start of the run
+ * @param gen last generation bred
  */
-float calculate_fitness(std::vector<int> gnome, Map &tsp)
+static bool stop_run(Stopping &stopping, Population &population, double seconds, int gen, MPI_Comm comm, int mpi_rank, int mpi_root)
 {
-	float f = 0;
-	for (int i = 0; i < gnome.size() - 1; i++)
+	if (!stopping.enabled)
+		return false;
+
+	double local[2] = {population.fitness[population.order[0]], -seconds}, global[2];
 	{
-		if (tsp.matrix.at(gnome[i]).at(gnome[i + 1]) == INT_MAX)
-			return INT_MAX;
-		f += tsp.matrix.at(gnome[i]).at(gnome[i + 1]);
+		PROFILE_SCOPE(PHASE_MPI);
+		MPI_Allreduce(local, global, 2, MPI_DOUBLE, MPI_MIN, comm);
 	}
-	return f;
+	stopping.stalled = global[0] < stopping.best ? 0 : stopping.stalled + 1;
+	stopping.best = min(stopping.best, (float)global[0]);
+	seconds = -global[1];
+
+	ostringstream reason;
+	if (stopping.gap >= 0 && stopping.best <= stopping.bound * (1 + stopping.gap / 100))
+		reason << "within " << 100 * (stopping.best - stopping.bound) / max(stopping.bound, 1e-9) << " % of the lower bound " << stopping.bound;
+	else if (stopping.stall > 0 && stopping.stalled >= stopping.stall)
+		reason << "no fitter tour in " << stopping.stalled << " batches";
+	else if (stopping.time_limit > 0 && seconds >= stopping.time_limit)
+		reason << "time limit of " << stopping.time_limit << " s";
+	else
+		return false;
+
+	if (mpi_rank == mpi_root)
+		cerr << "Stopped : " << reason.str() << " after generation " << gen << endl;
+	return true;
 }
 
 /**
- * @brief Compare gnome struct
- *
- * @param t1 gnome 1
- * @param t2 gnome 2
- * @return t1 < t2
+ * @brief Add the individuals of <incoming> to <population> and sort it again
  */
-bool less_than(struct individual const &t1,
-			   struct individual const &t2)
+static void merge_population(Population &population, Population &incoming, bool deterministic)
 {
-	return t1.fitness < t2.fitness;
+	PROFILE_SCOPE(PHASE_MERGE);
+	int size = population.size;
+	resize_population(population, size + incoming.size, population.length);
+	for (int i = 0; i < incoming.size; i++)
+	{
+		memcpy(gnome(population, size + i), gnome(incoming, i), population.length * sizeof(gene_t));
+		population.fitness[size + i] = incoming.fitness[i];
+	}
+	sort_population(population, deterministic);
 }
 
 /**
- * @brief Print Population (fitness and gnome) of a certain generation
+ * @brief Evaluate the fittest individual in full, so the fitness reported is the length of its tour
  *
- * @param gen Generation number
- * @param population Vector of individuals
+ * Children take the fitness of their parent plus the deltas of their mutations, rounded to float every generation, so
+ * above 2^24 the fitness drifts from the length along each line of descent. An individual that is no longer the
+ * fittest is moved after the ones now fitter, and the new fittest is evaluated too.
  */
-void print_generation(int gen, std::vector<individual> &population)
+template <class Distances>
+static void evaluate_elite(Population &population, const Distances &distances)
 {
-	cout << "Generation " << gen << " \n";
-	cout << "GNOME	 FITNESS VALUE\n";
-
-	for (int i = 0; i < population.size(); i++)
+	while (true)
 	{
-		for (int c : population[i].gnome)
-			cout << c << ",";
-		cout << " " << population[i].fitness << endl;
+		int best = population.order[0];
+		float fitness = calculate_fitness(gnome(population, best), population.length, distances);
+		PROFILE_COUNT(COUNTER_EVALUATIONS, 1);
+		if (fitness == population.fitness[best])
+			return;
+
+		population.fitness[best] = fitness;
+		int r = 0;
+		for (; r + 1 < population.size && population.fitness[population.order[r + 1]] < fitness; r++)
+			population.order[r] = population.order[r + 1];
+		population.order[r] = best;
 	}
 }
 
 /**
- * @brief Print gnome with best fitness in the population for a certain generation, Login levels control verbosity of output
+ * @brief Fitness of a tour, read from the cache if it was already evaluated or evaluated and cached
  *
- * @param gen Generation number
- * @param population Vector of individuals, EXPECTED to be order by fitness
- * @param oss output stream
+ * @param hash tour hash of the gnome (see tour_hash)
  */
-void print_best_gnome(int gen, int mpi_rank, std::vector<individual> &population, std::ostream &oss)
+template <class Distances>
+static float cached_evaluation(FitnessCache &cache, uint64_t hash, const gene_t *gnome, int V, const Distances &distances)
 {
-	bool FINAL = gen < 0;
-	if (FINAL && LOG_LEVEL > 1)
+	float fitness;
+	if (cached_fitness(cache, hash, fitness))
 	{
-		oss << "Generation FINAL \n";
-		oss << "BEST GNOME	 FITNESS VALUE\n";
-		for (int c : population[0].gnome)
-			oss << c << ",";
-		oss << " " << population[0].fitness << endl;
+		PROFILE_COUNT(COUNTER_CACHE_HITS, 1);
+		return fitness;
 	}
-	else if (!FINAL && LOG_LEVEL > 0)
-	{
-		oss << mpi_rank << "-" << gen << "          " << population[0].fitness << endl;
-	}
-	else if (!FINAL && LOG_LEVEL > 1)
+	fitness = calculate_fitness(gnome, V, distances);
+	PROFILE_COUNT(COUNTER_EVALUATIONS, 1);
+	cache_fitness(cache, hash, fitness);
+	return fitness;
+}
+
+/**
+ * @brief Hash every individual of <population> again and sort it with the copies of a tour last
+ *
+ * Called at the start and whenever individuals of other nodes join the population.
+ */
+static void rehash_population(const TourKeys &keys, Population &population, vector<uint64_t> &hashes, bool deterministic)
+{
+	hash_population(keys, population, 0, population.size, hashes);
+	sort_unique_population(population, hashes, population.size, deterministic);
+}
+
+/**
+ * @brief Breed <offspring> children in the pool of the steady-state algorithm, every thread on its own
+ *
+ * Each child comes from a parent selected by tournament (and a mate if there is crossover) and is mutated, repaired
+ * and evaluated like the children of the generational algorithm. It replaces the least fit individual of a shard of
+ * its thread if it is fitter. Threads never wait for each other but to lock a shard.
+ *
+ * @param pool pool of the population
+ * @param offspring number of children to breed among all threads
+ * @param cache if not NULL, fitness of the children that are evaluated in full
+ * @param keys keys of the cities of the hashes of the cache
+ */
+template <class Distances>
+static void breed_steady_state(SteadyPool &pool, long long offspring, Map &tsp, const Distances &distances, int MAX_NUMBER_MUTATIONS, CrossoverOperator CROSSOVER, LocalSearchMode LOCAL_SEARCH, vector<Rng> &thread_rngs, vector<LocalSearch> &thread_local_searches, vector<Crossover> &thread_crossovers, vector<vector<gene_t>> &thread_touched, FitnessCache *cache, const TourKeys &keys)
+{
+	int V = tsp.dimension;
+	long long bred = 0;
+
+#pragma omp parallel
 	{
-		oss << "Generation " << gen << " \n";
+		int t = omp_get_thread_num();
+		Rng &rng = thread_rngs[t];
+		gene_t *touched = thread_touched[t].data();
+		vector<gene_t> parent(V), mate(CROSSOVER != CROSSOVER_NONE ? V : 0), child(V);
+		PROFILE_SCOPE(PHASE_BREEDING);
 
-		oss << "BEST GNOME	 FITNESS VALUE\n";
+		while (true)
+		{
+			long long next;
+#pragma omp atomic capture
+			next = bred++;
+			if (next >= offspring)
+				break;
+
+			double delta = 0;
+			bool changed = false, evaluate = false;
+			float fitness;
+			if (CROSSOVER == CROSSOVER_NONE)
+			{
+				fitness = select_parent(pool, rng, child.data());
+			}
+			else
+			{
+				fitness = select_parent(pool, rng, parent.data());
+				select_parent(pool, rng, mate.data());
+				double crossover_delta = crossover(CROSSOVER, parent.data(), mate.data(), child.data(), tsp, rng, thread_crossovers[t]);
+
+				// OX and PMX give no delta (NAN), their children are evaluated in full. EAX children longer than the parent
+				// are discarded.
+				if (std::isnan(crossover_delta))
+					evaluate = changed = true;
+				else if (crossover_delta >= 0)
+					memcpy(child.data(), parent.data(), V * sizeof(gene_t));
+				else
+					delta += crossover_delta, changed = true;
+			}
+
+			int number_mutations = rand_num(rng, 0, MAX_NUMBER_MUTATIONS + 1);
+			{
+				PROFILE_SCOPE(PHASE_MUTATION);
+				for (int mut_i = 0; mut_i < number_mutations; mut_i++)
+					delta += mutate_gnome(child.data(), V, distances, rng, 0, 1, touched + 2 * mut_i);
+			}
+			changed |= number_mutations > 0;
+
+			if (LOCAL_SEARCH == LS_CHILDREN && number_mutations > 0)
+				delta -= improve_tour(child.data(), tsp, thread_local_searches[t], touched, 2 * number_mutations);
+
+			// A copy of the parent would only take the place of a different individual
+			if (!changed)
+				continue;
+
+			float child_fitness = fitness + delta;
+			if ((evaluate || fitness == INT_MAX) && cache)
+				child_fitness = cached_evaluation(*cache, tour_hash(keys, child.data(), V), child.data(), V, distances);
+			else if (evaluate || fitness == INT_MAX)
+			{
+				child_fitness = calculate_fitness(child.data(), V, distances);
+				PROFILE_COUNT(COUNTER_EVALUATIONS, 1);
+			}
 
-		for (int c : population[0].gnome)
-			oss << c << ",";
+			if (CHECK_DELTA)
+			{
+				float full_fitness = calculate_fitness(child.data(), V, distances);
+				if (fabs(full_fitness - child_fitness) > 1e-4 * max(1.0f, full_fitness))
+				{
+#pragma omp critical
+					cerr << "Error : delta fitness " << child_fitness << " does not match full fitness " << full_fitness << endl;
+				}
+			}
 
-		oss << " " << population[0].fitness << endl;
+			replace_worst(pool, t, rng, child.data(), child_fitness);
+		}
 	}
 }
 
 /**
- * @brief Execute genetic algorithm
+ * @brief Genetic algorithm of GenAlg, compiled for the distance storage of the problem
  *
- * @param tsp TSP Problem
- * @param POPULATION_SIZE Desired size of the populations
- * @param NUMBER_GENERATIONS Desired number of generations
- * @param CHILD_PER_GNOME Number of children each individual has through mutations each iteration
- * @param MAX_NUMBER_MUTATIONS Maximum number of mutations per gnome 
- * @param GEN_BATCH Number of generations for each processor before logging (and synchronizing)
- * @param mpi_rank MPI rank of current node
- * @param mpi_size MPI size
- * @param mpi_root MPI rank of the root node
- * @param oss output stream
- * @param best_fitness_sol reference to return the best solution found by node
- * @param execution_time reference to return execution time in milliseconds
+ * @param distances distances of the problem (see withDistances)
  */
-void GenAlg(Map &tsp, int POPULATION_SIZE, int NUMBER_GENERATIONS, int CHILD_PER_GNOME, int MAX_NUMBER_MUTATIONS, int GEN_BATCH, int mpi_rank, int mpi_size, int mpi_root, bool SYNC_BATCH, std::ostream &oss, float &best_fitness_sol, microseconds &execution_time)
+template <class Distances>
+static void genetic_algorithm(Map &tsp, const Distances &distances, Options &options, MPI_Comm comm, int mpi_rank, int mpi_size, int mpi_root, std::ostream &oss, float &best_fitness_sol, microseconds &execution_time, GeneticBuffers &buffers)
 {
+	int POPULATION_SIZE = options.POPULATION_SIZE,
+		NUMBER_GENERATIONS = options.NUMBER_GENERATIONS,
+		CHILD_PER_GNOME = options.CHILD_PER_GNOME,
+		MAX_NUMBER_MUTATIONS = options.MAX_NUMBER_MUTATIONS,
+		GEN_BATCH = options.GEN_BATCH;
+	bool SYNC_BATCH = options.SYNC_BATCH,
+		 OVERLAP = options.OVERLAP,
+		 DETERMINISTIC = options.DETERMINISTIC,
+		 DEDUP = options.DEDUP;
+	int LOG_LEVEL = options.LOG_LEVEL;
+	LocalSearchMode LOCAL_SEARCH = options.LOCAL_SEARCH;
+
+	// 2-opt reverses paths, which changes the length of asymmetric tours in ways the moves do not account for
+	if (LOCAL_SEARCH != LS_NONE && !tsp.symmetric)
+	{
+		if (mpi_rank == mpi_root)
+			cerr << "Warning : local search disabled, " << tsp.name << " is asymmetric" << endl;
+		LOCAL_SEARCH = LS_NONE;
+	}
+	CrossoverOperator CROSSOVER = options.CROSSOVER;
+
+	// EAX joins subtours with 2-opt moves, which assume the length of a path does not depend on its direction
+	if (CROSSOVER == CROSSOVER_EAX && !tsp.symmetric)
+	{
+		if (mpi_rank == mpi_root)
+			cerr << "Warning : EAX replaced by OX, " << tsp.name << " is asymmetric" << endl;
+		CROSSOVER = CROSSOVER_OX;
+	}
+	bool EVALUATE_CHILDREN = CROSSOVER == CROSSOVER_OX || CROSSOVER == CROSSOVER_PMX;
+	bool STEADY_STATE = options.STEADY_STATE;
+
+	// Threads of the steady-state algorithm replace individuals in the order they finish their children
+	if (STEADY_STATE && DETERMINISTIC && mpi_rank == mpi_root)
+		cerr << "Warning : --steady runs are not deterministic" << endl;
+	MigrationTopology ISLAND = options.ISLAND;
 
 	// Generation Number
 	int gen = 1;
 
-	vector<struct individual> population, intermediate_population, new_population;
-	struct individual temp;
+	// Parents and children are double-buffered, buffers are reused every generation (and run)
+	Population &population = buffers.population, &new_population = buffers.new_population;
 
 	// Each node initialize its particles
 	int NODE_POPULATION_SIZE;
@@ -271,155 +556,514 @@ void GenAlg(Map &tsp, int POPULATION_SIZE, int NUMBER_GENERATIONS, int CHILD_PER
 		NODE_POPULATION_SIZE = POPULATION_SIZE / mpi_size;
 	}
 
+	if (tsp.dimension > MAX_GENE_CITY)
+	{
+		cout << "Error : " << tsp.dimension << " cities do not fit in the gene type, compile without GENE_16BIT" << endl;
+		MPI_Abort(MPI_COMM_WORLD, -1);
+	}
+
+	// Independent random stream for every thread of every node (a single thread if the caller is already parallel)
+	int max_threads = omp_in_parallel() ? 1 : omp_get_max_threads();
+	vector<Rng> thread_rngs(max_threads);
+	for (int t = 0; t < max_threads; t++)
+		thread_rngs[t] = stream_rng(options.SEED, (uint64_t)mpi_rank * max_threads + t);
+
+	// Seeded gnomes are the first of the node, numbered across nodes so every heuristic runs once in the whole population
+	int seeded_size = (int)(options.SEEDING * NODE_POPULATION_SIZE + 0.5);
+
+	// Local search, the seeding heuristics and EAX need the candidate neighbours of every city
+	if ((LOCAL_SEARCH != LS_NONE || seeded_size > 0 || CROSSOVER == CROSSOVER_EAX) && tsp.neighbourK < options.CANDIDATES)
+		buildNeighbourCache(tsp, options.CANDIDATES);
+
 	// Populating the GNOME pool.
 	int initial_city = 0;
-	for (int i = 0; i < NODE_POPULATION_SIZE; i++)
+	resize_population(population, NODE_POPULATION_SIZE, tsp.dimension);
+	resize_population(new_population, NODE_POPULATION_SIZE, tsp.dimension);
+
+	// A resumed run starts from the individuals, random streams and generation of a checkpoint, the rest are created
+	bool RESUME = options.RESUME_FILE != "";
+	int resumed = 0;
+	float last_improved_fitness = -1;
+	if (RESUME)
 	{
-		temp.gnome = create_gnome(tsp.dimension, initial_city);
-		temp.fitness = calculate_fitness(temp.gnome, tsp);
-		population.push_back(temp);
+		resumed = load_checkpoint(options.RESUME_FILE, comm, mpi_rank, mpi_size, population, thread_rngs, gen, last_improved_fitness, options.SEED);
+		if (mpi_rank == mpi_root)
+			cerr << "Resumed : generation " << gen << ", seed " << options.SEED << endl;
 	}
+#pragma omp parallel
+	{
+		Seeding seeding;
+		PROFILE_SCOPE(PHASE_INITIALIZATION);
+
+#pragma omp for schedule(dynamic, 1) nowait
+		for (int i = resumed; i < NODE_POPULATION_SIZE; i++)
+		{
+			Rng &rng = thread_rngs[omp_get_thread_num()];
+			if (DETERMINISTIC)
+				rng = counter_rng(options.SEED, mpi_rank, 0, i);
+			if (i < seeded_size)
+				seed_gnome(gnome(population, i), tsp, seed_heuristic(i * mpi_size + mpi_rank), rng, seeding);
+			else
+				create_gnome(gnome(population, i), tsp.dimension, initial_city, rng);
+		}
+	}
+	batch_fitness(population, resumed, NODE_POPULATION_SIZE - resumed, tsp);
 
 	// Order population based on fitness
-	sort(population.begin(), population.end(), less_than);
+	sort_population(population, DETERMINISTIC);
 
-	/* LOG */ print_best_gnome(1, mpi_rank, population, oss);
+	/* LOG */ print_best_gnome(RESUME ? gen - 1 : 1, mpi_rank, population, oss, LOG_LEVEL);
 
-	auto start = high_resolution_clock::now();
+	// Tour hash of every individual and fitness of the tours evaluated in the last generations
+	vector<uint64_t> &hashes = buffers.hashes, &new_hashes = buffers.new_hashes;
+	TourKeys keys;
+	FitnessCache cache;
+	if (DEDUP)
+	{
+		init_tour_keys(keys, tsp.dimension, tsp.symmetric);
+		init_fitness_cache(cache, (size_t)FITNESS_CACHE_GENERATIONS * NODE_POPULATION_SIZE);
 
-	// Iteration to perform population crossing and gene mutation (each generation)
-	for (gen; gen <= NUMBER_GENERATIONS; gen += GEN_BATCH)
+		// The steady-state algorithm has no parent slots, it only uses the cache
+		if (!STEADY_STATE)
+			rehash_population(keys, population, hashes, DETERMINISTIC);
+	}
+
+	// Local search needs scratch memory for every thread
+	vector<LocalSearch> &thread_local_searches = buffers.local_searches;
+	vector<vector<gene_t>> &thread_touched = buffers.touched;
+	thread_local_searches.resize(max_threads);
+	thread_touched.resize(max_threads);
+	for (int t = 0; t < max_threads; t++)
+		thread_touched[t].resize(2 * MAX_NUMBER_MUTATIONS + 2);
+	if (LOCAL_SEARCH != LS_NONE)
 	{
-		for (int gen_batch = gen; gen_batch < gen + GEN_BATCH; gen_batch++)
+		for (int t = 0; t < max_threads; t++)
+			init_local_search(thread_local_searches[t], tsp.dimension);
+	}
+
+	// Crossover too, allocated once for the whole run
+	vector<Crossover> &thread_crossovers = buffers.crossovers;
+	thread_crossovers.resize(max_threads);
+	if (CROSSOVER != CROSSOVER_NONE)
+	{
+		for (int t = 0; t < max_threads; t++)
+			init_crossover(thread_crossovers[t], tsp.dimension);
+	}
+
+	// Buffers for synchronization between nodes
+	Synchronization sync;
+	sync.comm = comm;
+	if (SYNC_BATCH)
+	{
+		init_codec(sync.codec, tsp.dimension);
+		if (mpi_rank == mpi_root)
 		{
+			sync.received_bytes.resize(mpi_size);
+			sync.displacements.resize(mpi_size);
+		}
+	}
+
+	Migration migration;
+	if (ISLAND != MIGRATION_NONE)
+		init_migration(migration, ISLAND, options.MIGRANTS, tsp.dimension, comm, mpi_rank, mpi_size);
+
+	// Pool shared by the threads of the steady-state algorithm and children bred in it
+	SteadyPool pool;
+	long long offspring = 0;
+
+	// Records of every batch, written by root
+	Telemetry telemetry;
+	init_telemetry(telemetry, options.TELEMETRY_FILE, comm, mpi_rank, mpi_size, mpi_root);
+
+	// State of the node saved every few batches, and at the end
+	Checkpoint checkpoint;
+	init_checkpoint(checkpoint, options.CHECKPOINT_FILE, options.CHECKPOINT_EVERY, mpi_rank, mpi_size, options.SEED);
+
+	// Lower bound of the optimal tour for the gap, a 1-tree only bounds symmetric problems
+	Stopping stopping;
+	stopping.enabled = options.GAP >= 0 || options.STALL > 0 || options.TIME_LIMIT > 0;
+	stopping.gap = options.GAP;
+	stopping.stall = options.STALL;
+	stopping.time_limit = options.TIME_LIMIT;
+	stopping.bound = 0;
+	stopping.best = INFINITY;
+	stopping.stalled = 0;
+	if (stopping.gap >= 0 && !tsp.symmetric)
+	{
+		if (mpi_rank == mpi_root)
+			cerr << "Warning : --gap ignored, " << tsp.name << " is asymmetric" << endl;
+		stopping.gap = -1;
+	}
+	if (stopping.gap >= 0)
+	{
+		stopping.bound = LowerBound(tsp, options, comm, mpi_root, population.fitness[population.order[0]]);
+		if (mpi_rank == mpi_root)
+			cerr << "Lower bound : " << stopping.bound << endl;
+	}
+	bool stopped = false;
+
+	auto start = high_resolution_clock::now();
+	record_telemetry(telemetry, RESUME ? gen - 1 : 1, population, 0, 0, 0);
 
-			/* SELECTION */
-			// POPULATION_SIZE / CHILD_PER_GNOME gnomes are selected to breed next generation
+	// Iteration to perform population crossing and gene mutation (each generation)
+	for (gen; gen <= NUMBER_GENERATIONS && !stopped; gen += GEN_BATCH)
+	{
+		auto batch_start = high_resolution_clock::now();
+		long long batch_children = 0;
 
-			// The fittest does not mutate
-			for (int child = 0; child < CHILD_PER_GNOME; child++)
+		if (STEADY_STATE)
+		{
+			// The fittest is taken to a local optimum whenever a new one appears
+			int best = population.order[0];
+			if (LOCAL_SEARCH == LS_ELITE && population.fitness[best] != last_improved_fitness)
 			{
-				new_population.push_back(population[0]);
+				population.fitness[best] -= improve_tour(gnome(population, best), tsp, thread_local_searches[0]);
+				last_improved_fitness = population.fitness[best];
 			}
 
-			/* DEBUG */ // static bool first = true;
-
-#pragma omp parallel
+			// As many children as GEN_BATCH generations, bred without barriers
+			long long batch_offspring = (long long)GEN_BATCH * NODE_POPULATION_SIZE;
+			init_pool(pool, population, max_threads, CHILD_PER_GNOME);
+			breed_steady_state(pool, batch_offspring, tsp, distances, MAX_NUMBER_MUTATIONS, CROSSOVER, LOCAL_SEARCH, thread_rngs, thread_local_searches, thread_crossovers, thread_touched, DEDUP ? &cache : NULL, keys);
+			free_pool(pool);
+			offspring += batch_offspring;
+			batch_children = batch_offspring;
+			PROFILE_COUNT(COUNTER_CHILDREN, batch_offspring);
+
+			sort_population(population, DETERMINISTIC);
+			if (ISLAND != MIGRATION_NONE && receive_migrants(migration, population))
+				sort_population(population, DETERMINISTIC);
+		}
+		else
+		{
+			for (int gen_batch = gen; gen_batch < gen + GEN_BATCH; gen_batch++)
 			{
-				/* DEBIG */ // if (first)
-				/* DEBIG */ // {
-				/* DEBIG */ // 	first = false;
-				/* DEBIG */ // 	cout << " threads; " << omp_get_num_threads() << endl;
-				/* DEBIG */ // }
-				// TODO make a population for each thread private and join at the end
-				vector<struct individual> thread_population;
-				thread_population.clear();
-				// For every other selected member of the population
-
-#pragma omp for schedule(dynamic,1)
-				for (int member = 1; member < (NODE_POPULATION_SIZE / CHILD_PER_GNOME); member++)
+
+				/* SELECTION */
+				// POPULATION_SIZE / CHILD_PER_GNOME gnomes are selected to breed next generation
+				int parents = NODE_POPULATION_SIZE / CHILD_PER_GNOME;
+
+				// Child <child> of member <member> goes to slot member * CHILD_PER_GNOME + child, threads write their
+				// children straight into the next population
+				int new_size = max(parents, 1) * CHILD_PER_GNOME;
+				resize_population(new_population, new_size, tsp.dimension);
+				if (DEDUP)
+					new_hashes.resize(new_size);
+
+				// The fittest is taken to a local optimum whenever a new one appears
+				int best = population.order[0];
+				if (LOCAL_SEARCH == LS_ELITE && population.fitness[best] != last_improved_fitness)
 				{
-					/* DEBUG */ // cout << "ID: " << omp_get_thread_num() << " TOT: " << omp_get_num_threads() << " member: " << member << endl;
-					struct individual p1 = population[member];
+					population.fitness[best] -= improve_tour(gnome(population, best), tsp, thread_local_searches[0]);
+					last_improved_fitness = population.fitness[best];
+					if (DEDUP)
+						hashes[best] = tour_hash(keys, gnome(population, best), tsp.dimension);
+				}
 
-					/* BREEDING / MUTATING */
-					// For simplicity of algorithm selected gnomes will have CHILD_PER_GNOME children
-					// These children are computed mutating a random amount of times
-					for (int child = 0; child < CHILD_PER_GNOME; child++)
+				// The fittest does not mutate
+				for (int child = 0; child < CHILD_PER_GNOME; child++)
+				{
+					memcpy(gnome(new_population, child), gnome(population, population.order[0]), tsp.dimension * sizeof(gene_t));
+					new_population.fitness[child] = population.fitness[population.order[0]];
+					if (DEDUP)
+						new_hashes[child] = hashes[population.order[0]];
+				}
+
+#pragma omp parallel
+				{
+					Rng &rng = thread_rngs[omp_get_thread_num()];
+					LocalSearch &local_search = thread_local_searches[omp_get_thread_num()];
+					Crossover &cx = thread_crossovers[omp_get_thread_num()];
+					gene_t *touched = thread_touched[omp_get_thread_num()].data();
+					// Without the barrier of the loop the breeding time of a thread does not include waiting for others
+					PROFILE_SCOPE(PHASE_BREEDING);
+					// For every other selected member of the population
+
+#pragma omp for schedule(dynamic,1) nowait
+					for (int member = 1; member < parents; member++)
 					{
-						// Random number of mutations for child
-						int number_mutations = ((double)rand() / (double)RAND_MAX) * (MAX_NUMBER_MUTATIONS + 1);
-						struct individual paux = p1;
+						/* DEBUG */ // cout << "ID: " << omp_get_thread_num() << " TOT: " << omp_get_num_threads() << " member: " << member << endl;
+						int p1 = population.order[member];
+
+						// Numbers of the member independent of the thread breeding it
+						if (DETERMINISTIC)
+							rng = counter_rng(options.SEED, mpi_rank, gen_batch, member);
 
-						// TODO index is passed to the mutate to ensure 2 threads dont get the same city in the gnome and parallelize mutation
-						for (int mut_i = 0; mut_i < number_mutations; mut_i++)
+						/* BREEDING / MUTATING */
+						// For simplicity of algorithm selected gnomes will have CHILD_PER_GNOME children
+						// These children are computed mutating a random amount of times
+						for (int child = 0; child < CHILD_PER_GNOME; child++)
 						{
-							//cout << "member: " << i << " child: " << child << " mutation: " << mut_i << " total n mut: " << number_mutations << " total threads: " << omp_get_num_threads() << endl;
-							//paux.gnome = mutate_gnome(paux.gnome, tsp.dimension, mut_i, omp_get_num_threads());
-							paux.gnome = mutate_gnome(paux.gnome, tsp.dimension, 0, 1);
+							// Random number of mutations for child
+							int number_mutations = rand_num(rng, 0, MAX_NUMBER_MUTATIONS + 1);
+							int paux = member * CHILD_PER_GNOME + child;
+							gene_t *paux_gnome = gnome(new_population, paux);
+							memcpy(paux_gnome, gnome(population, p1), tsp.dimension * sizeof(gene_t));
+							new_population.fitness[paux] = population.fitness[p1];
+
+							// Child fitness is updated with the delta of every mutation instead of evaluating the whole tour
+							double delta = 0;
+
+							// And its hash with the edges every mutation changes, unless crossover or 2-opt rebuilt it
+							uint64_t hash = DEDUP ? hashes[p1] : 0;
+							bool rehash = false;
+
+							// The child combines the member with another selected member
+							if (CROSSOVER != CROSSOVER_NONE)
+							{
+								int mate = rand_num(rng, 0, parents - 1);
+								if (mate >= member)
+									mate++;
+								double crossover_delta = crossover(CROSSOVER, gnome(population, p1), gnome(population, population.order[mate]), paux_gnome, tsp, rng, cx);
+
+								// OX and PMX give no delta (NAN), their children are evaluated once all are built (EVALUATE_CHILDREN).
+								// EAX children longer than the member are discarded, the member survives instead.
+								if (std::isnan(crossover_delta))
+									rehash = true;
+								else if (crossover_delta >= 0)
+									memcpy(paux_gnome, gnome(population, p1), tsp.dimension * sizeof(gene_t));
+								else
+									delta += crossover_delta, rehash = true;
+							}
+							{
+								PROFILE_SCOPE(PHASE_MUTATION);
+								for (int mut_i = 0; mut_i < number_mutations; mut_i++)
+								{
+									delta += mutate_gnome(paux_gnome, tsp.dimension, distances, rng, 0, 1, touched + 2 * mut_i, DEDUP && !rehash ? &hash : NULL, &keys);
+								}
+							}
+
+							// Repair the child around the swapped cities
+							if (LOCAL_SEARCH == LS_CHILDREN && number_mutations > 0)
+							{
+								double gain = improve_tour(paux_gnome, tsp, local_search, touched, 2 * number_mutations);
+								delta -= gain;
+								rehash |= gain != 0;
+							}
+
+							if (DEDUP)
+							{
+								new_hashes[paux] = rehash ? tour_hash(keys, paux_gnome, tsp.dimension) : hash;
+								if (CHECK_DELTA && new_hashes[paux] != tour_hash(keys, paux_gnome, tsp.dimension))
+								{
+#pragma omp critical
+									cerr << "Error : updated tour hash does not match the hash of the child" << endl;
+								}
+							}
+
+							// Children of OX and PMX are evaluated together once all are built
+							if (EVALUATE_CHILDREN)
+								continue;
+
+							if (population.fitness[p1] == INT_MAX && DEDUP)
+								new_population.fitness[paux] = cached_evaluation(cache, new_hashes[paux], paux_gnome, tsp.dimension, distances);
+							else if (population.fitness[p1] == INT_MAX)
+								new_population.fitness[paux] = calculate_fitness(paux_gnome, tsp.dimension, distances);
+							else
+								new_population.fitness[paux] += delta;
+
+							if (CHECK_DELTA)
+							{
+								float full_fitness = calculate_fitness(paux_gnome, tsp.dimension, distances);
+								if (fabs(full_fitness - new_population.fitness[paux]) > 1e-4 * max(1.0f, full_fitness))
+								{
+#pragma omp critical
+									cerr << "Error : delta fitness " << new_population.fitness[paux] << " does not match full fitness " << full_fitness << endl;
+								}
+							}
 						}
-						paux.fitness = calculate_fitness(paux.gnome, tsp);
-						thread_population.push_back(paux);
 					}
 				}
 
-#pragma omp critical
+				if (EVALUATE_CHILDREN)
+					batch_fitness(new_population, CHILD_PER_GNOME, new_size - CHILD_PER_GNOME, tsp);
+				swap(population, new_population);
+				if (DEDUP)
+					swap(hashes, new_hashes);
+				PROFILE_COUNT(COUNTER_CHILDREN, new_size - CHILD_PER_GNOME);
+				batch_children += new_size - CHILD_PER_GNOME;
+
+				// Only the parents of the next generation are ordered, unless migrants replace the least fit, and copies of a
+				// tour go after all distinct ones
+				if (DEDUP)
 				{
-					new_population.insert(new_population.end(), thread_population.begin(), thread_population.end());
+					int copies = sort_unique_population(population, hashes, ISLAND != MIGRATION_NONE ? population.size : max(parents, 1), DETERMINISTIC);
+					PROFILE_COUNT(COUNTER_DUPLICATES, copies);
 				}
-			}
+				else if (ISLAND != MIGRATION_NONE)
+					sort_population(population, DETERMINISTIC);
+				else
+					select_population(population, max(parents, 1), DETERMINISTIC);
 
-			population = new_population;
-			new_population.clear();
-
-			// Order population based on fitness
-			sort(population.begin(), population.end(), less_than);
+				// Migrants are merged as soon as they arrive
+				if (ISLAND != MIGRATION_NONE && receive_migrants(migration, population))
+				{
+					if (DEDUP)
+						rehash_population(keys, population, hashes, DETERMINISTIC);
+					else
+						sort_population(population, DETERMINISTIC);
+				}
+			}
 		}
-		/* LOG */ print_best_gnome(gen + GEN_BATCH - 1, mpi_rank, population, oss);
+		evaluate_elite(population, distances);
+		/* LOG */ print_best_gnome(gen + GEN_BATCH - 1, mpi_rank, population, oss, LOG_LEVEL);
 
-		if (SYNC_BATCH)
+		if (telemetry.enabled)
 		{
+			auto now = high_resolution_clock::now();
+			double batch_seconds = max(1e-9, duration<double>(now - batch_start).count());
+			long long bytes_sent = sync.bytes_sent + (ISLAND != MIGRATION_NONE ? migration.bytes_sent : 0);
+			record_telemetry(telemetry, gen + GEN_BATCH - 1, population, duration_cast<microseconds>(now - start).count(), batch_children / batch_seconds, bytes_sent);
+		}
 
-			// Share between all of them the best individuals and start from the same population
-			int *gnome_v = new int[NODE_POPULATION_SIZE * tsp.dimension];
-			float *fitness_v = new float[NODE_POPULATION_SIZE];
-
-			serialize_population(population, NODE_POPULATION_SIZE, gnome_v, fitness_v, tsp.dimension);
+		if (ISLAND != MIGRATION_NONE)
+			send_migrants(migration, population, thread_rngs[0], mpi_rank, mpi_size);
 
-			float *received_fitness_v = NULL;
-			int *received_gnome_v = NULL;
+		if (SYNC_BATCH)
+		{
 
-			if (mpi_rank == mpi_root)
+			if (!OVERLAP)
 			{
-				received_gnome_v = new int[POPULATION_SIZE * tsp.dimension];
-				received_fitness_v = new float[POPULATION_SIZE];
+				// Share between all of them the best individuals and start from the same population
+				synchronize_populations(sync, population, population, NODE_POPULATION_SIZE, POPULATION_SIZE, DETERMINISTIC, mpi_rank, mpi_size, mpi_root);
+				if (DEDUP && !STEADY_STATE)
+					rehash_population(keys, population, hashes, DETERMINISTIC);
 			}
-
-			MPI_Gather(fitness_v, NODE_POPULATION_SIZE, MPI_FLOAT, received_fitness_v, NODE_POPULATION_SIZE, MPI_FLOAT, mpi_root, MPI_COMM_WORLD);
-
-			MPI_Gather(gnome_v, NODE_POPULATION_SIZE * tsp.dimension, MPI_INT, received_gnome_v, NODE_POPULATION_SIZE * tsp.dimension, MPI_INT, mpi_root, MPI_COMM_WORLD);
-
-			delete[] gnome_v;
-			delete[] fitness_v;
-
-			gnome_v = new int[NODE_POPULATION_SIZE * tsp.dimension];
-			fitness_v = new float[NODE_POPULATION_SIZE];
-			if (mpi_rank == mpi_root)
+			else
 			{
-				intermediate_population.clear();
-				deserialize_population(intermediate_population, POPULATION_SIZE, received_gnome_v, received_fitness_v, tsp.dimension);
-				delete[] received_gnome_v, received_fitness_v;
+				// Merge the previous synchronization and send a snapshot of the population while the next batch is bred
+				if (sync.communication.joinable())
+				{
+					{
+						PROFILE_SCOPE(PHASE_MPI);
+						sync.communication.join();
+					}
+					merge_population(population, sync.incoming, DETERMINISTIC);
+					if (DEDUP && !STEADY_STATE)
+						rehash_population(keys, population, hashes, DETERMINISTIC);
+				}
 
-				sort(intermediate_population.begin(), intermediate_population.end(), less_than);
+				// Decided before the next synchronization starts, only one thread calls MPI at a time
+				stopped = stop_run(stopping, population, duration<double>(high_resolution_clock::now() - start).count(), gen + GEN_BATCH - 1, comm, mpi_rank, mpi_root);
 
-				serialize_population(intermediate_population, NODE_POPULATION_SIZE, gnome_v, fitness_v, tsp.dimension);
+				resize_population(sync.snapshot, population.size, tsp.dimension);
+				append_population(sync.snapshot, 0, population);
+				sync.snapshot.order = population.order;
+				sync.communication = thread(synchronize_populations, ref(sync), ref(sync.snapshot), ref(sync.incoming), NODE_POPULATION_SIZE, POPULATION_SIZE, DETERMINISTIC, mpi_rank, mpi_size, mpi_root);
 			}
 
-			MPI_Bcast(gnome_v, NODE_POPULATION_SIZE * tsp.dimension, MPI_INT, mpi_root, MPI_COMM_WORLD);
-			MPI_Bcast(fitness_v, NODE_POPULATION_SIZE, MPI_FLOAT, mpi_root, MPI_COMM_WORLD);
+			/* LOG */ print_best_gnome(gen + GEN_BATCH - 1, mpi_rank, population, oss, LOG_LEVEL);
+		}
+
+		if (!(SYNC_BATCH && OVERLAP))
+			stopped = stop_run(stopping, population, duration<double>(high_resolution_clock::now() - start).count(), gen + GEN_BATCH - 1, comm, mpi_rank, mpi_root);
 
-			population.clear();
-			deserialize_population(population, NODE_POPULATION_SIZE, gnome_v, fitness_v, tsp.dimension);
+		save_checkpoint(checkpoint, population, gen + GEN_BATCH, thread_rngs, last_improved_fitness);
+	}
 
-			/* LOG */ print_best_gnome(gen + GEN_BATCH - 1, mpi_rank, population, oss);
+	if (sync.communication.joinable())
+	{
+		{
+			PROFILE_SCOPE(PHASE_MPI);
+			sync.communication.join();
 		}
+		merge_population(population, sync.incoming, DETERMINISTIC);
+	}
+
+	if (ISLAND != MIGRATION_NONE)
+	{
+		finish_migration(migration, population);
+		sort_population(population, DETERMINISTIC);
 	}
 
+	evaluate_elite(population, distances);
+	finish_checkpoint(checkpoint, population, gen, thread_rngs, last_improved_fitness);
+
 	auto stop = high_resolution_clock::now();
 	execution_time = duration_cast<microseconds>(stop - start);
 
-	// Seriliaze first solution to send to reduce to best
-	int first_n = 1;
+	// Children per second of all nodes, with the most verbose log only
+	if (STEADY_STATE && LOG_LEVEL > 1)
+	{
+		double offspring_rate = offspring / max(1e-6, execution_time.count() / 1e6), total_offspring_rate = 0;
+		{
+			PROFILE_SCOPE(PHASE_MPI);
+			MPI_Reduce(&offspring_rate, &total_offspring_rate, 1, MPI_DOUBLE, MPI_SUM, mpi_root, comm);
+		}
+		if (mpi_rank == mpi_root)
+			cerr << "Offspring per second : " << total_offspring_rate << endl;
+	}
 
-	int *gnome_v = new int[1 * tsp.dimension];
-	float *fitness_v = new float[1];
+	// Best solution of the node, reduced to the best of all nodes
+	float fitness_best = population.fitness[population.order[0]];
 	float best_fitness_sol_v[1];
 
-	serialize_population(population, first_n, gnome_v, fitness_v, tsp.dimension);
-	MPI_Reduce(fitness_v, best_fitness_sol_v, 1, MPI_FLOAT, MPI_MIN, mpi_root, MPI_COMM_WORLD);
+	{
+		PROFILE_SCOPE(PHASE_MPI);
+		MPI_Reduce(&fitness_best, best_fitness_sol_v, 1, MPI_FLOAT, MPI_MIN, mpi_root, comm);
+	}
 
 	if (mpi_rank == mpi_root)
 	{
 		best_fitness_sol = best_fitness_sol_v[0];
 	}
-}
\ No newline at end of file
+
+	/* LOG */ print_best_gnome(-1, mpi_rank, population, oss, LOG_LEVEL);
+	finish_telemetry(telemetry);
+}
+
+/**
+ * @brief Execute genetic algorithm
+ *
+ * Options used:
+ * - POPULATION_SIZE Desired size of the populations
+ * - NUMBER_GENERATIONS Desired number of generations
+ * - CHILD_PER_GNOME Number of children each individual has through mutations each iteration
+ * - MAX_NUMBER_MUTATIONS Maximum number of mutations per gnome 
+ * - GEN_BATCH Number of generations for each processor before logging (and synchronizing)
+ * - SYNC_BATCH Share the best individuals of all nodes after each batch
+ * - OVERLAP Synchronize from a communication thread while the next batch is bred, the individuals received are merged
+ *   into the population at the following batch boundary
+ * - SEED Seed of the random number streams of every node and thread
+ * - DETERMINISTIC Derive the random numbers of each task from its counters so runs are reproducible
+ * - LOCAL_SEARCH Improve with 2-opt / Or-opt the fittest individual (LS_ELITE) or every child (LS_CHILDREN)
+ * - CANDIDATES Number of nearest neighbours considered by the local search
+ * - SEEDING Fraction of the initial population built by construction heuristics instead of randomly
+ * - ISLAND Topology of the islands, each node sends its MIGRANTS fittest individuals to its neighbours after each batch
+ *   and merges the ones it receives as they arrive, without waiting for other nodes
+ * - CHECKPOINT_FILE Save the population, random streams and generation of every node every CHECKPOINT_EVERY batches
+ *   and at the end, without waiting for the disk
+ * - RESUME_FILE Start from the checkpoint of a previous run (with any number of nodes) instead of a new population,
+ *   and with its seed. NUMBER_GENERATIONS counts the generations of the previous runs too.
+ * - GAP, STALL, TIME_LIMIT Stop before NUMBER_GENERATIONS once the fittest tour of all nodes is within GAP percent of
+ *   the Held-Karp lower bound (symmetric problems), has not improved in STALL batches, or TIME_LIMIT seconds have passed
+ *   since the start. All nodes stop after the same batch.
+ * - DEDUP Keep the tour hash of every individual, so copies of a tour go after all distinct tours when the parents are
+ *   selected, and reuse the fitness of tours already evaluated instead of evaluating them in full again (children of
+ *   INT_MAX parents and of the steady-state algorithm, OX and PMX children are still evaluated together)
+ *
+ * The fitness evaluation and the mutations read the distances through a view specialised for the storage of the problem
+ * (element and layout of the dense matrix or lazy coordinates), selected once here.
+ *
+ * Called from a parallel region, the run uses the calling thread only, so several problems can be solved at once on
+ * MPI_COMM_SELF (MPI_THREAD_MULTIPLE).
+ *
+ * @param tsp TSP Problem
+ * @param options parameters of the algorithm
+ * @param comm MPI nodes solving the problem together
+ * @param mpi_root MPI rank of the root node in comm
+ * @param oss output stream
+ * @param best_fitness_sol reference to return the best solution found by node
+ * @param execution_time reference to return execution time in milliseconds
+ * @param buffers memory of the previous run, reused
+ */
+void GenAlg(Map &tsp, Options &options, MPI_Comm comm, int mpi_root, std::ostream &oss, float &best_fitness_sol, microseconds &execution_time, GeneticBuffers &buffers)
+{
+	int mpi_rank, mpi_size;
+	MPI_Comm_rank(comm, &mpi_rank);
+	MPI_Comm_size(comm, &mpi_size);
+
+	withDistances(tsp, [&](const auto &distances) {
+		genetic_algorithm(tsp, distances, options, comm, mpi_rank, mpi_size, mpi_root, oss, best_fitness_sol, execution_time, buffers);
+	});
+}
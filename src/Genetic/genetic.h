@@ -9,21 +9,30 @@
  *
  */
 
-#ifndef LOG_LEVEL
-#define LOG_LEVEL 0
+/// Check every incrementally updated fitness against a full evaluation of the tour (debug)
+#ifndef CHECK_DELTA
+#define CHECK_DELTA 0
 #endif
 
 #include <cstring>
 #include <chrono>
+#include <vector>
 #include "tsplib.h"
+#include "population.h"
+#include "localsearch.h"
+#include "crossover.h"
+#include "mpi.h"
 
 using namespace std::chrono;
 
-/// Structure of a GNOME string defines the path traversed by the salesman while the fitness value of the path is stored in an integer
-struct individual
+/// Memory of a run of the Genetic Algorithm, kept for the next run so solving many problems does not allocate again
+struct GeneticBuffers
 {
-	std::vector<int> gnome;
-	float fitness;
+	Population population, new_population;      // Parents and children, double-buffered
+	std::vector<LocalSearch> local_searches;     // Scratch memory of every thread
+	std::vector<Crossover> crossovers;
+	std::vector<std::vector<gene_t>> touched;
+	std::vector<uint64_t> hashes, new_hashes;    // Tour hash of every parent and child (DEDUP)
 };
 
-void GenAlg(Map &tsp, int POPULATION_SIZE, int NUMBER_GENERATIONS, int CHILD_PER_GNOME, int MAX_NUMBER_MUTATIONS, int GEN_BATCH, int mpi_rank, int mpi_size, int mpi_root, bool SYNC_BATCH, std::ostream &oss, float &best_fitness_sol, microseconds &execution_time);
\ No newline at end of file
+void GenAlg(Map &tsp, Options &options, MPI_Comm comm, int mpi_root, std::ostream &oss, float &best_fitness_sol, microseconds &execution_time, GeneticBuffers &buffers);
\ No newline at end of file
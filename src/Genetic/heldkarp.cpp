@@ -0,0 +1,240 @@
+/**
+ * @file heldkarp.cpp
+ * @author Javier Vela
+ * @brief Source file of the exact solver of small problems, Held-Karp dynamic programming over subsets of cities
+ * @version 0.1
+ * @date 2022-01-05
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <limits.h>
+#include "heldkarp.h"
+#include "distance.h"
+#include "fitness.h"
+#include "profiler.h"
+
+using namespace std;
+
+/**
+ * @brief Length of the edge from city <a> to city <b>, infinite if there is no edge (INT_MAX)
+ */
+template <class Distances>
+static inline float edge(const Distances &distances, int a, int b)
+{
+	float d = distances(a, b);
+	return d == INT_MAX ? INFINITY : d;
+}
+
+/**
+ * @brief Shortest path tables of the dynamic programming
+ *
+ * Tours start at city 1, the other m cities are the bits of the subsets (bit a is city a + 2). The length of the
+ * shortest path from city 1 through the cities of S ending at city i of S is only stored for the subsets that contain
+ * i, with bit i removed from the index, so the table has m * 2^(m - 1) floats instead of m * 2^m.
+ */
+struct HeldKarpTable
+{
+	size_t half; // 2^(m - 1), subsets of the other cities
+	vector<float> length;
+
+	inline float &at(int i, uint32_t S)
+	{
+		uint32_t low = S & ((1u << i) - 1);
+		return length[(size_t)i * half + ((S >> (i + 1)) << i | low)];
+	}
+};
+
+/**
+ * @brief Subset of <k> of the <m> bits at position <rank> of the increasing order of those subsets
+ *
+ * @param binomial binomial coefficients, binomial[a][b] = a choose b
+ */
+static uint32_t unrank_subset(long long rank, int k, int m, const vector<vector<long long>> &binomial)
+{
+	uint32_t S = 0;
+	for (int bits = k, top = m - 1; bits > 0; bits--, top--)
+	{
+		while (binomial[top][bits] > rank)
+			top--;
+		S |= 1u << top;
+		rank -= binomial[top][bits];
+	}
+	return S;
+}
+
+/**
+ * @brief Next subset with the same number of bits in increasing order (Gosper's hack)
+ */
+static inline uint32_t next_subset(uint32_t S)
+{
+	uint32_t lowest = S & -S, carry = S + lowest;
+	return (((carry ^ S) >> 2) / lowest) | carry;
+}
+
+/**
+ * @brief Solve the problem exactly, in O(n^2 2^n) time
+ *
+ * Subsets are filled by layers of the same size, every subset of a layer only reads the previous one, so the subsets of
+ * a layer are split between the threads, in blocks of consecutive subsets walked with Gosper's hack.
+ *
+ * @param tour where to write the optimal tour, starting at city 1
+ * @param distances distances of the problem (see withDistances)
+ * @return length of the optimal tour
+ */
+template <class Distances>
+static float solve(int n, vector<gene_t> &tour, const Distances &distances)
+{
+	tour.resize(n);
+	tour[0] = 1;
+	int m = n - 1;
+	if (m < 1)
+		return calculate_fitness(tour.data(), n, distances);
+
+	HeldKarpTable table;
+	table.half = (size_t)1 << (m - 1);
+	table.length.assign((size_t)m * table.half, INFINITY);
+
+	for (int i = 0; i < m; i++)
+		table.at(i, 1u << i) = edge(distances, 1, i + 2);
+
+	vector<vector<long long>> binomial(m + 1, vector<long long>(m + 1, 0));
+	for (int a = 0; a <= m; a++)
+	{
+		binomial[a][0] = 1;
+		for (int b = 1; b <= a; b++)
+			binomial[a][b] = binomial[a - 1][b - 1] + binomial[a - 1][b];
+	}
+
+	const long long block = 1024;
+	long long subsets = 1LL << m;
+	for (int k = 2; k <= m; k++)
+	{
+		long long layer = binomial[m][k];
+#pragma omp parallel for schedule(dynamic, 1)
+		for (long long first = 0; first < layer; first += block)
+		{
+			uint32_t S = unrank_subset(first, k, m, binomial);
+			for (long long s = first; s < min(first + block, layer); s++, S = next_subset(S))
+			{
+				for (uint32_t last = S; last; last &= last - 1)
+				{
+					int i = __builtin_ctz(last);
+					uint32_t previous = S ^ (1u << i);
+					float shortest = INFINITY;
+					for (uint32_t before = previous; before; before &= before - 1)
+					{
+						int j = __builtin_ctz(before);
+						shortest = min(shortest, table.at(j, previous) + edge(distances, j + 2, i + 2));
+					}
+					table.at(i, S) = shortest;
+				}
+			}
+		}
+	}
+
+	// Close the tour back to city 1 and walk the table back from its last city
+	uint32_t S = (uint32_t)(subsets - 1);
+	int i = 0;
+	float shortest = INFINITY;
+	for (int j = 0; j < m; j++)
+	{
+		float length = table.at(j, S) + edge(distances, j + 2, 1);
+		if (length < shortest)
+		{
+			shortest = length;
+			i = j;
+		}
+	}
+
+	for (int position = n - 1; position > 0; position--)
+	{
+		tour[position] = i + 2;
+		uint32_t previous = S ^ (1u << i);
+		if (previous == 0)
+			break;
+		int before = __builtin_ctz(previous);
+		for (uint32_t rest = previous; rest; rest &= rest - 1)
+		{
+			int j = __builtin_ctz(rest);
+			if (table.at(j, previous) + edge(distances, j + 2, i + 2) == table.at(i, S))
+			{
+				before = j;
+				break;
+			}
+		}
+		S = previous;
+		i = before;
+	}
+
+	return calculate_fitness(tour.data(), n, distances);
+}
+
+/**
+ * @brief Optimal tour of a problem of up to HELD_KARP_LIMIT cities
+ *
+ * @param tsp TSP problem
+ * @param tour where to write the optimal tour, starting at city 1
+ * @return length of the optimal tour (INT_MAX if the problem has no tour)
+ */
+float held_karp(const Map &tsp, vector<gene_t> &tour)
+{
+	if (tsp.dimension > HELD_KARP_LIMIT)
+	{
+		cout << "Error : " << tsp.name << " has more than " << HELD_KARP_LIMIT << " cities to be solved exactly" << endl;
+		exit(-1);
+	}
+
+	PROFILE_SCOPE(PHASE_EXACT);
+	float length;
+	withDistances(tsp, [&](const auto &distances) {
+		length = solve(tsp.dimension, tour, distances);
+	});
+	return length;
+}
+
+/**
+ * @brief Exact solver with the interface of GenAlg, used instead of the Genetic Algorithm for small problems
+ *
+ * Root solves the problem with all its threads, the other nodes wait for the result.
+ *
+ * @param tsp TSP Problem, of up to HELD_KARP_LIMIT cities
+ * @param options parameters of the run (LOG_LEVEL)
+ * @param comm MPI nodes of the run
+ * @param mpi_root MPI rank of the root node in comm
+ * @param oss output stream
+ * @param best_fitness_sol reference to return the length of the optimal tour (root)
+ * @param execution_time reference to return execution time in microseconds
+ */
+void HeldKarp(Map &tsp, Options &options, MPI_Comm comm, int mpi_root, std::ostream &oss, float &best_fitness_sol, microseconds &execution_time)
+{
+	int mpi_rank;
+	MPI_Comm_rank(comm, &mpi_rank);
+
+	auto start = high_resolution_clock::now();
+	vector<gene_t> tour;
+	float length;
+	if (mpi_rank == mpi_root)
+		length = held_karp(tsp, tour);
+	MPI_Bcast(&length, 1, MPI_FLOAT, mpi_root, comm);
+	execution_time = duration_cast<microseconds>(high_resolution_clock::now() - start);
+
+	if (mpi_rank != mpi_root)
+		return;
+	best_fitness_sol = length;
+
+	/* LOG */
+	if (options.LOG_LEVEL > 0)
+		oss << mpi_rank << "-" << 1 << "          " << length << "\n";
+	if (options.LOG_LEVEL > 1)
+	{
+		oss << "Generation FINAL \n";
+		oss << "BEST GNOME	 FITNESS VALUE\n";
+		for (int c = 0; c < tsp.dimension; c++)
+			oss << tour[c] << ",";
+		oss << " " << length << "\n";
+	}
+}
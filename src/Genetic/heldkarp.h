@@ -0,0 +1,30 @@
+/**
+ * @file heldkarp.h
+ * @author Javier Vela
+ * @brief Header file of the exact solver of small problems, Held-Karp dynamic programming over subsets of cities
+ * @version 0.1
+ * @date 2022-01-05
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef HELDKARP_H
+#define HELDKARP_H
+
+#include <chrono>
+#include <vector>
+#include <iostream>
+#include "tsplib.h"
+#include "population.h"
+#include "mpi.h"
+
+using namespace std::chrono;
+
+/// Biggest problem the exact solver accepts, its table of (n - 1) 2^(n - 2) floats takes 386 MB (see --exact)
+#define HELD_KARP_LIMIT 24
+
+float held_karp(const Map &tsp, std::vector<gene_t> &tour);
+void HeldKarp(Map &tsp, Options &options, MPI_Comm comm, int mpi_root, std::ostream &oss, float &best_fitness_sol, microseconds &execution_time);
+
+#endif /* HELDKARP_H */
@@ -0,0 +1,317 @@
+/**
+ * @file localsearch.cpp
+ * @author Javier Vela
+ * @brief Source file of the 2-opt / Or-opt local search used to improve gnomes of the Genetic Algorithm
+ * @version 0.1
+ * @date 2021-12-16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <algorithm>
+#include "localsearch.h"
+#include "distance.h"
+#include "profiler.h"
+
+using namespace std;
+
+/// Minimum gain of a move to be applied
+#define MIN_GAIN 1e-6
+
+/**
+ * @brief Allocate the scratch memory of a local search for problems of <dimension> cities
+ *
+ * @param ls local search
+ * @param dimension number of cities
+ */
+void init_local_search(LocalSearch &ls, int dimension)
+{
+	ls.n = dimension;
+	ls.tour = NULL;
+	ls.pos.assign(dimension + 1, 0);
+	ls.queued.assign(dimension + 1, 0);
+	ls.queue.assign(dimension, 0);
+	ls.head = 0;
+	ls.count = 0;
+}
+
+static inline int succ(LocalSearch &ls, int city)
+{
+	int p = ls.pos[city] + 1;
+	return ls.tour[p == ls.n ? 0 : p];
+}
+
+static inline int pred(LocalSearch &ls, int city)
+{
+	int p = ls.pos[city] - 1;
+	return ls.tour[p < 0 ? ls.n - 1 : p];
+}
+
+/**
+ * @brief Add a city to the queue of cities to look at (clear its don't-look bit)
+ */
+static inline void activate(LocalSearch &ls, int city)
+{
+	if (ls.queued[city])
+		return;
+	ls.queued[city] = 1;
+	int tail = ls.head + ls.count;
+	ls.queue[tail >= ls.n ? tail - ls.n : tail] = city;
+	ls.count++;
+}
+
+/**
+ * @brief Reverse the tour between positions <i> and <j> (both included, going forward)
+ *
+ * The complementary path is reversed instead when it is shorter, which is the same cyclic tour traversed backwards
+ */
+static void reverse_path(LocalSearch &ls, int i, int j)
+{
+	int n = ls.n;
+	int len = j - i;
+	if (len < 0)
+		len += n;
+	len++;
+
+	if (2 * len > n)
+	{
+		int ni = j + 1 == n ? 0 : j + 1;
+		int nj = i == 0 ? n - 1 : i - 1;
+		i = ni;
+		j = nj;
+		len = n - len;
+	}
+
+	for (int k = 0; k < len / 2; k++)
+	{
+		gene_t ci = ls.tour[i], cj = ls.tour[j];
+		ls.tour[i] = cj;
+		ls.tour[j] = ci;
+		ls.pos[cj] = i;
+		ls.pos[ci] = j;
+
+		if (++i == n)
+			i = 0;
+		if (--j < 0)
+			j = n - 1;
+	}
+}
+
+/**
+ * @brief Replace tour edges {a, b} and {c, d} by {a, c} and {b, d}, both edges traversed in the same direction
+ */
+static void two_opt_move(LocalSearch &ls, int a, int b, int c, int d)
+{
+	if (succ(ls, a) == b)
+		reverse_path(ls, ls.pos[b], ls.pos[c]);
+	else
+		reverse_path(ls, ls.pos[a], ls.pos[d]);
+}
+
+/**
+ * @brief Move the segment s1..s2 (between p and nx) between the cities c and e = succ(c)
+ *
+ * @param keep_orientation insert as c s1..s2 e if true, as c s2..s1 e if false
+ */
+static void or_opt_move(LocalSearch &ls, int p, int s1, int s2, int nx, int c, int e, bool keep_orientation)
+{
+	two_opt_move(ls, p, s1, c, e);  // p c .. nx s2..s1 e
+	two_opt_move(ls, p, c, nx, s2); // p nx .. c s2..s1 e
+	if (keep_orientation)
+		two_opt_move(ls, c, s2, s1, e); // p nx .. c s1..s2 e
+}
+
+/**
+ * @brief Try 2-opt moves that add an edge between <a> and one of its candidate neighbours
+ *
+ * @return gain of the applied move, 0 if none improves the tour
+ */
+static double try_2opt(LocalSearch &ls, Map &tsp, int a)
+{
+	const int *candidates = &tsp.neighbours[(size_t)a * tsp.neighbourK];
+	const float *candidate_distance = &tsp.neighbourDistance[(size_t)a * tsp.neighbourK];
+
+	for (int dir = 0; dir < 2; dir++)
+	{
+		int b = dir == 0 ? succ(ls, a) : pred(ls, a);
+		double d_ab = getDistance(tsp, a, b);
+
+		for (int k = 0; k < tsp.neighbourK; k++)
+		{
+			int c = candidates[k];
+			double g1 = d_ab - candidate_distance[k];
+			if (g1 <= MIN_GAIN)
+				break;
+
+			int d = dir == 0 ? succ(ls, c) : pred(ls, c);
+			if (c == b || d == a)
+				continue;
+
+			double gain = g1 + getDistance(tsp, c, d) - getDistance(tsp, b, d);
+			if (gain > MIN_GAIN)
+			{
+				two_opt_move(ls, a, b, c, d);
+				activate(ls, a);
+				activate(ls, b);
+				activate(ls, c);
+				activate(ls, d);
+				return gain;
+			}
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Try Or-opt moves of the segments of up to OR_OPT_MAX_SEGMENT cities that start or end at <a>
+ *
+ * @return gain of the applied move, 0 if none improves the tour
+ */
+static double try_or_opt(LocalSearch &ls, Map &tsp, int a)
+{
+	int n = ls.n;
+
+	for (int len = 1; len <= OR_OPT_MAX_SEGMENT && len < n - 3; len++)
+	{
+		for (int side = 0; side < (len == 1 ? 1 : 2); side++)
+		{
+			// Segment s1..s2 going forward, starting at a or ending at a
+			int first = side == 0 ? ls.pos[a] : ls.pos[a] - (len - 1);
+			if (first < 0)
+				first += n;
+			int last = first + len - 1;
+			if (last >= n)
+				last -= n;
+
+			int s1 = ls.tour[first], s2 = ls.tour[last];
+			int p = pred(ls, s1), nx = succ(ls, s2);
+
+			double g1 = getDistance(tsp, p, s1) + getDistance(tsp, s2, nx) - getDistance(tsp, p, nx);
+			if (g1 <= MIN_GAIN)
+				continue;
+
+			for (int end = 0; end < 2; end++)
+			{
+				int s = end == 0 ? s1 : s2;
+				const int *candidates = &tsp.neighbours[(size_t)s * tsp.neighbourK];
+				const float *candidate_distance = &tsp.neighbourDistance[(size_t)s * tsp.neighbourK];
+
+				for (int k = 0; k < tsp.neighbourK; k++)
+				{
+					int x = candidates[k];
+					if (candidate_distance[k] >= g1)
+						break;
+
+					int offset = ls.pos[x] - first;
+					if (offset < 0)
+						offset += n;
+					if (offset < len)
+						continue;
+
+					// x before the segment (new edge x-s) or after it (new edge s-x)
+					for (int at = 0; at < 2; at++)
+					{
+						int c = at == 0 ? x : pred(ls, x);
+						int e = at == 0 ? succ(ls, x) : x;
+
+						int offset_c = ls.pos[c] - first;
+						if (offset_c < 0)
+							offset_c += n;
+						int offset_e = ls.pos[e] - first;
+						if (offset_e < 0)
+							offset_e += n;
+						if (offset_c < len || offset_e < len || e == p)
+							continue;
+
+						// Orientation that creates the edge to x
+						bool keep_orientation = (at == 0) == (s == s1);
+						double added = keep_orientation ? getDistance(tsp, c, s1) + getDistance(tsp, s2, e)
+														: getDistance(tsp, c, s2) + getDistance(tsp, s1, e);
+						double gain = g1 + getDistance(tsp, c, e) - added;
+
+						if (gain > MIN_GAIN)
+						{
+							or_opt_move(ls, p, s1, s2, nx, c, e, keep_orientation);
+							activate(ls, p);
+							activate(ls, nx);
+							activate(ls, c);
+							activate(ls, e);
+							activate(ls, s1);
+							activate(ls, s2);
+							return gain;
+						}
+					}
+				}
+			}
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Improve a tour with 2-opt and Or-opt moves over the candidate neighbours of the problem until no move improves it
+ *
+ * Cities are looked at from a queue (don't-look bits): only the cities given as active and the endpoints of the edges
+ * changed by applied moves are queued, so improving a tour that differs from a local optimum in a few edges is cheap.
+ * Distances are expected to be symmetric and the neighbour cache of the problem to be built.
+ *
+ * @param tour tour to improve in place
+ * @param tsp TSP problem object with neighbour cache
+ * @param ls local search scratch memory of the calling thread
+ * @param active cities to look at first (their tour neighbours are also queued)
+ * @param n_active number of active cities, negative to look at every city
+ * @return gain of the local search (fitness before minus fitness after)
+ */
+double improve_tour(gene_t *tour, Map &tsp, LocalSearch &ls, const gene_t *active, int n_active)
+{
+	PROFILE_SCOPE(PHASE_LOCAL_SEARCH);
+	int n = tsp.dimension;
+	if (n < 8 || tsp.neighbourK == 0)
+		return 0;
+	if (ls.n != n)
+		init_local_search(ls, n);
+
+	ls.tour = tour;
+	for (int i = 0; i < n; i++)
+		ls.pos[tour[i]] = i;
+
+	ls.head = 0;
+	ls.count = 0;
+	if (n_active < 0)
+	{
+		for (int i = 0; i < n; i++)
+			activate(ls, tour[i]);
+	}
+	else
+	{
+		for (int i = 0; i < n_active; i++)
+		{
+			activate(ls, active[i]);
+			activate(ls, pred(ls, active[i]));
+			activate(ls, succ(ls, active[i]));
+		}
+	}
+
+	double total_gain = 0;
+	while (ls.count > 0)
+	{
+		int a = ls.queue[ls.head];
+		if (++ls.head == n)
+			ls.head = 0;
+		ls.count--;
+		ls.queued[a] = 0;
+
+		double gain = try_2opt(ls, tsp, a);
+		if (gain == 0)
+			gain = try_or_opt(ls, tsp, a);
+
+		if (gain > 0)
+		{
+			total_gain += gain;
+			activate(ls, a);
+		}
+	}
+
+	return total_gain;
+}
@@ -0,0 +1,36 @@
+/**
+ * @file localsearch.h
+ * @author Javier Vela
+ * @brief Header file of the 2-opt / Or-opt local search used to improve gnomes of the Genetic Algorithm
+ * @version 0.1
+ * @date 2021-12-16
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef LOCALSEARCH_H
+#define LOCALSEARCH_H
+
+#include <vector>
+#include "tsplib.h"
+#include "population.h"
+
+/// Longest segment moved by Or-opt moves
+#define OR_OPT_MAX_SEGMENT 3
+
+/// Scratch memory of the local search, one per thread so several tours are improved concurrently
+struct LocalSearch
+{
+	int n;                   // Cities of the tour
+	gene_t *tour;            // Tour being improved
+	std::vector<int> pos;    // Position of every city in the tour
+	std::vector<char> queued; // Don't-look bits (a city is looked at only while queued)
+	std::vector<int> queue;  // Circular queue of cities to look at
+	int head, count;
+};
+
+void init_local_search(LocalSearch &ls, int dimension);
+double improve_tour(gene_t *tour, Map &tsp, LocalSearch &ls, const gene_t *active = NULL, int n_active = -1);
+
+#endif /* LOCALSEARCH_H */
@@ -0,0 +1,209 @@
+/**
+ * @file migration.cpp
+ * @author Javier Vela
+ * @brief Source file of the asynchronous migration between islands (MPI nodes) of the Genetic Algorithm
+ * @version 0.1
+ * @date 2021-12-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <algorithm>
+#include <cstring>
+#include "migration.h"
+#include "profiler.h"
+
+using namespace std;
+
+/**
+ * @brief Set up the migration of a node and post its first receive
+ *
+ * RING sends to the next node, TORUS to the four neighbours of the node in a 2D grid of nodes and RANDOM to a node
+ * chosen every time.
+ *
+ * @param migration migration state to initialize
+ * @param topology topology of the islands
+ * @param migrants fittest individuals sent in every message
+ * @param length genes per gnome
+ * @param comm MPI nodes of the run
+ * @param mpi_rank MPI rank of current node
+ * @param mpi_size MPI size
+ */
+void init_migration(Migration &migration, MigrationTopology topology, int migrants, int length, MPI_Comm comm, int mpi_rank, int mpi_size)
+{
+	migration.topology = topology;
+	migration.migrants = migrants;
+	migration.length = length;
+	migration.targets.clear();
+	migration.sent.assign(mpi_size, 0);
+	migration.send_codecs.resize(mpi_size);
+	migration.receive_codecs.resize(mpi_size);
+	for (int r = 0; r < mpi_size; r++)
+	{
+		init_codec(migration.send_codecs[r], length);
+		init_codec(migration.receive_codecs[r], length);
+	}
+	migration.received = 0;
+	migration.bytes_sent = 0;
+	MPI_Comm_dup(comm, &migration.comm);
+
+	if (topology == MIGRATION_RING)
+	{
+		migration.targets.push_back((mpi_rank + 1) % mpi_size);
+	}
+	else if (topology == MIGRATION_TORUS)
+	{
+		int dims[2] = {0, 0};
+		MPI_Dims_create(mpi_size, 2, dims);
+		int row = mpi_rank / dims[1], col = mpi_rank % dims[1];
+		int neighbours[4] = {row * dims[1] + (col + 1) % dims[1],
+							 row * dims[1] + (col + dims[1] - 1) % dims[1],
+							 ((row + 1) % dims[0]) * dims[1] + col,
+							 ((row + dims[0] - 1) % dims[0]) * dims[1] + col};
+		for (int neighbour : neighbours)
+		{
+			if (find(migration.targets.begin(), migration.targets.end(), neighbour) == migration.targets.end())
+				migration.targets.push_back(neighbour);
+		}
+	}
+	else
+	{
+		migration.targets.push_back(-1);
+	}
+
+	// A single node has no one to migrate to
+	migration.targets.erase(remove(migration.targets.begin(), migration.targets.end(), mpi_rank), migration.targets.end());
+	if (mpi_size == 1)
+		migration.targets.clear();
+
+	migration.send_buffers.assign(migration.targets.size(), vector<uint8_t>());
+	migration.send_requests.assign(migration.targets.size(), MPI_REQUEST_NULL);
+	migration.receive_buffer.resize(max_encoded_size(length, migrants));
+	resize_population(migration.arrived, migrants, length);
+	MPI_Irecv(migration.receive_buffer.data(), migration.receive_buffer.size(), MPI_BYTE, MPI_ANY_SOURCE, MIGRATION_TAG, migration.comm, &migration.receive_request);
+}
+
+/**
+ * @brief Send the fittest individuals of <population> to the neighbours of the node
+ *
+ * Neighbours whose previous message has not been delivered yet are skipped, so a slow node never stalls the sender.
+ *
+ * @param migration migration state
+ * @param population population, EXPECTED to be sorted
+ * @param rng random number generator (target of MIGRATION_RANDOM)
+ */
+void send_migrants(Migration &migration, Population &population, Rng &rng, int mpi_rank, int mpi_size)
+{
+	PROFILE_SCOPE(PHASE_MIGRATION);
+	for (size_t t = 0; t < migration.targets.size(); t++)
+	{
+		int done;
+		MPI_Test(&migration.send_requests[t], &done, MPI_STATUS_IGNORE);
+		if (!done)
+			continue;
+
+		int target = migration.targets[t];
+		if (migration.topology == MIGRATION_RANDOM)
+		{
+			target = rand_num(rng, 0, mpi_size - 1);
+			if (target >= mpi_rank)
+				target++;
+		}
+
+		vector<uint8_t> &message = migration.send_buffers[t];
+		message.clear();
+		encode_population(migration.send_codecs[target], population, migration.migrants, message);
+		set_codec_reference(migration.send_codecs[target], gnome(population, population.order[0]));
+
+		MPI_Isend(message.data(), message.size(), MPI_BYTE, target, MIGRATION_TAG, migration.comm, &migration.send_requests[t]);
+		migration.sent[target]++;
+		migration.bytes_sent += message.size();
+	}
+}
+
+/**
+ * @brief Decode the last message received and replace the least fit individuals of <population> by its migrants when
+ * fitter
+ */
+static bool merge_migrants(Migration &migration, Population &population, MPI_Status &status)
+{
+	PROFILE_SCOPE(PHASE_MERGE);
+	TourCodec &codec = migration.receive_codecs[status.MPI_SOURCE];
+	Population &arrived = migration.arrived;
+	arrived.size = decode_population(codec, migration.receive_buffer.data(), arrived, 0, migration.migrants);
+	set_codec_reference(codec, gnome(arrived, 0));
+
+	bool merged = false;
+	for (int i = 0; i < arrived.size && i < population.size; i++)
+	{
+		int worst = population.order[population.size - 1 - i];
+		if (arrived.fitness[i] < population.fitness[worst])
+		{
+			population.fitness[worst] = arrived.fitness[i];
+			memcpy(gnome(population, worst), gnome(arrived, i), migration.length * sizeof(gene_t));
+			merged = true;
+			PROFILE_COUNT(COUNTER_MIGRANTS, 1);
+		}
+	}
+	return merged;
+}
+
+/**
+ * @brief Merge every message arrived since the last call without waiting for more
+ *
+ * @param migration migration state
+ * @param population population, EXPECTED to be sorted
+ * @return true if some migrant entered the population (it has to be sorted again)
+ */
+bool receive_migrants(Migration &migration, Population &population)
+{
+	PROFILE_SCOPE(PHASE_MIGRATION);
+	bool merged = false;
+	while (true)
+	{
+		int arrived;
+		MPI_Status status;
+		MPI_Test(&migration.receive_request, &arrived, &status);
+		if (!arrived)
+			return merged;
+
+		// Later messages replace individuals that are already migrants
+		if (merged)
+			sort_population(population);
+		merged |= merge_migrants(migration, population, status);
+		migration.received++;
+		MPI_Irecv(migration.receive_buffer.data(), migration.receive_buffer.size(), MPI_BYTE, MPI_ANY_SOURCE, MIGRATION_TAG, migration.comm, &migration.receive_request);
+	}
+}
+
+/**
+ * @brief Receive the messages still in flight and release the migration state
+ *
+ * Every node learns how many messages were sent to it and merges them, so every send completes; then the receive left
+ * posted is cancelled. Collective over all nodes.
+ *
+ * @param migration migration state
+ * @param population population, EXPECTED to be sorted, it has to be sorted again after the call
+ */
+void finish_migration(Migration &migration, Population &population)
+{
+	PROFILE_SCOPE(PHASE_MIGRATION);
+	int expected = 0;
+	MPI_Reduce_scatter_block(migration.sent.data(), &expected, 1, MPI_INT, MPI_SUM, migration.comm);
+
+	while (migration.received < expected)
+	{
+		MPI_Status status;
+		MPI_Wait(&migration.receive_request, &status);
+		if (merge_migrants(migration, population, status))
+			sort_population(population);
+		migration.received++;
+		MPI_Irecv(migration.receive_buffer.data(), migration.receive_buffer.size(), MPI_BYTE, MPI_ANY_SOURCE, MIGRATION_TAG, migration.comm, &migration.receive_request);
+	}
+
+	MPI_Cancel(&migration.receive_request);
+	MPI_Wait(&migration.receive_request, MPI_STATUS_IGNORE);
+	MPI_Waitall(migration.send_requests.size(), migration.send_requests.data(), MPI_STATUSES_IGNORE);
+	MPI_Comm_free(&migration.comm);
+}
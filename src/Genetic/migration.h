@@ -0,0 +1,56 @@
+/**
+ * @file migration.h
+ * @author Javier Vela
+ * @brief Header file of the asynchronous migration between islands (MPI nodes) of the Genetic Algorithm
+ * @version 0.1
+ * @date 2021-12-21
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef MIGRATION_H
+#define MIGRATION_H
+
+#include <vector>
+#include "tsplib.h"
+#include "population.h"
+#include "random.h"
+#include "codec.h"
+#include "mpi.h"
+
+/// Tag of the messages with migrants
+#define MIGRATION_TAG 1
+
+/**
+ * @brief Migration state of a node
+ *
+ * A message holds the migrants encoded against the fittest migrant of the previous message of the same link. One
+ * receive from any source is always posted, and there is one send buffer per neighbour, reused once its previous send
+ * completes.
+ */
+struct Migration
+{
+	MigrationTopology topology;
+	MPI_Comm comm;                                // Duplicate of the communicator of the run only used for migrations
+	int migrants;                                 // Individuals per message
+	int length;                                   // Genes per gnome
+	std::vector<int> targets;                     // Neighbours migrants are sent to (chosen every time for MIGRATION_RANDOM)
+	std::vector<std::vector<uint8_t>> send_buffers; // One per neighbour
+	std::vector<MPI_Request> send_requests;
+	std::vector<int> sent;                        // Messages sent to every node
+	std::vector<TourCodec> send_codecs;           // Codec of the link to every node
+	std::vector<TourCodec> receive_codecs;        // Codec of the link from every node
+	std::vector<uint8_t> receive_buffer;          // Big enough for any message
+	MPI_Request receive_request;
+	Population arrived;                           // Migrants of the last message received
+	int received;                                 // Messages received
+	long long bytes_sent;                         // Bytes of all messages sent
+};
+
+void init_migration(Migration &migration, MigrationTopology topology, int migrants, int length, MPI_Comm comm, int mpi_rank, int mpi_size);
+void send_migrants(Migration &migration, Population &population, Rng &rng, int mpi_rank, int mpi_size);
+bool receive_migrants(Migration &migration, Population &population);
+void finish_migration(Migration &migration, Population &population);
+
+#endif /* MIGRATION_H */
@@ -0,0 +1,287 @@
+/**
+ * @file population.cpp
+ * @author Javier Vela
+ * @brief Source file of the flat population storage of the Genetic Algorithm
+ * @version 0.1
+ * @date 2021-12-12
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include "population.h"
+#include "profiler.h"
+#include "omp.h"
+
+using namespace std;
+
+/// Bits of the digit sorted by each pass of the radix sort
+#define RADIX_BITS 8
+#define RADIX_DIGITS (1 << RADIX_BITS)
+
+/// Keys sorted by each thread of the radix sort, at least
+#define RADIX_SORT_BLOCK 4096
+
+/**
+ * @brief Set the number of individuals and the gnome length of a population
+ *
+ * Buffers only grow: once a population has held <size> individuals, resizing it again to that size or less does not
+ * allocate memory.
+ *
+ * @param p population
+ * @param size number of individuals
+ * @param length genes per gnome
+ */
+void resize_population(Population &p, int size, int length)
+{
+	const int genes_per_line = GNOME_ALIGNMENT / sizeof(gene_t);
+
+	p.size = size;
+	p.length = length;
+	p.stride = (length + genes_per_line - 1) / genes_per_line * genes_per_line;
+
+	if (p.genes.size() < (size_t)size * p.stride)
+		p.genes.resize((size_t)size * p.stride);
+	if (p.fitness.size() < (size_t)size)
+		p.fitness.resize(size);
+	p.order.resize(size);
+}
+
+/**
+ * @brief Copy all individuals of <src> into <dst> starting at individual <at>
+ *
+ * @param dst destination population, big enough to hold at + src.size individuals
+ * @param at first individual of dst to overwrite
+ * @param src source population with the same stride
+ */
+void append_population(Population &dst, int at, const Population &src)
+{
+	memcpy(gnome(dst, at), gnome(src, 0), (size_t)src.size * src.stride * sizeof(gene_t));
+	memcpy(&dst.fitness[at], &src.fitness[0], src.size * sizeof(float));
+}
+
+/**
+ * @brief Key of a fitness that sorts as an unsigned integer in the same order as the float
+ */
+static inline uint32_t fitness_key(float fitness)
+{
+	uint32_t bits;
+	memcpy(&bits, &fitness, sizeof(bits));
+	return bits ^ ((bits >> 31) ? 0xffffffffu : 0x80000000u);
+}
+
+/**
+ * @brief Sort the order of a population by fitness with a parallel LSD radix sort of (fitness, index) keys
+ *
+ * Every thread counts the digits of its own block of keys and scatters them to the offsets of its block, so each pass
+ * is stable and individuals with the same fitness stay ordered by index. Passes where every key has the same digit
+ * are skipped (the high digits of similar fitness values).
+ */
+static void radix_sort(Population &p)
+{
+	int n = p.size;
+	p.keys.resize(2 * (size_t)n);
+	int max_threads = max(1, min(omp_get_max_threads(), n / RADIX_SORT_BLOCK));
+	vector<size_t> counts((size_t)max_threads << RADIX_BITS);
+	bool skip;
+
+#pragma omp parallel num_threads(max_threads) shared(skip)
+	{
+		int threads = omp_get_num_threads(), t = omp_get_thread_num();
+		int begin = (int)((long long)n * t / threads), end = (int)((long long)n * (t + 1) / threads);
+		size_t *count = &counts[(size_t)t << RADIX_BITS];
+
+		// Every thread swaps its own pointers after each pass, all of them take the same passes
+		uint64_t *src = p.keys.data(), *dst = src + n;
+
+		for (int i = begin; i < end; i++)
+			src[i] = (uint64_t)fitness_key(p.fitness[i]) << 32 | (uint32_t)i;
+
+		for (int shift = 32; shift < 64; shift += RADIX_BITS)
+		{
+			fill(count, count + RADIX_DIGITS, 0);
+			for (int i = begin; i < end; i++)
+				count[(src[i] >> shift) & (RADIX_DIGITS - 1)]++;
+#pragma omp barrier
+
+			// Offsets digit by digit, thread by thread within a digit
+#pragma omp single
+			{
+				skip = false;
+				size_t offset = 0;
+				for (int d = 0; d < RADIX_DIGITS; d++)
+				{
+					size_t first = offset;
+					for (int u = 0; u < threads; u++)
+					{
+						size_t c = counts[((size_t)u << RADIX_BITS) + d];
+						counts[((size_t)u << RADIX_BITS) + d] = offset;
+						offset += c;
+					}
+					// Every key in the same bucket, the pass would leave them as they are
+					skip |= offset - first == (size_t)n;
+				}
+			}
+
+			if (!skip)
+			{
+				for (int i = begin; i < end; i++)
+					dst[count[(src[i] >> shift) & (RADIX_DIGITS - 1)]++] = src[i];
+#pragma omp barrier
+				swap(src, dst);
+			}
+		}
+
+		for (int i = begin; i < end; i++)
+			p.order[i] = (int)(uint32_t)src[i];
+	}
+}
+/// Less fit first, ties broken comparing the gnomes if <total>
+struct FitnessOrder
+{
+	const Population &p;
+	bool total;
+
+	bool operator()(int a, int b) const
+	{
+		if (p.fitness[a] != p.fitness[b] || !total)
+			return p.fitness[a] < p.fitness[b];
+		return memcmp(gnome(p, a), gnome(p, b), p.length * sizeof(gene_t)) < 0;
+	}
+};
+
+/**
+ * @brief Sort the individuals of a population by fitness, permuting the order indices instead of the gnomes
+ *
+ * Populations of RADIX_SORT_MIN_SIZE individuals or more are radix sorted in parallel.
+ *
+ * @param p population
+ * @param total_order break ties of fitness comparing the gnomes, so the sorted content does not depend on where
+ * each individual is stored
+ */
+void sort_population(Population &p, bool total_order)
+{
+	PROFILE_SCOPE(PHASE_SELECTION);
+	p.order.resize(p.size);
+	FitnessOrder less = {p, total_order};
+
+	if (p.size < RADIX_SORT_MIN_SIZE)
+	{
+		iota(p.order.begin(), p.order.end(), 0);
+		sort(p.order.begin(), p.order.end(), less);
+		return;
+	}
+
+	radix_sort(p);
+	if (!total_order)
+		return;
+
+	// Individuals of the same fitness are ordered by index, order them by gnome
+	for (int i = 0, j; i < p.size; i = j)
+	{
+		for (j = i + 1; j < p.size && p.fitness[p.order[j]] == p.fitness[p.order[i]]; j++)
+			;
+		if (j - i > 1)
+			sort(p.order.begin() + i, p.order.begin() + j, less);
+	}
+}
+
+/**
+ * @brief Select the <k> fittest individuals of a population, permuting the order indices instead of the gnomes
+ *
+ * Only order[0] ... order[k - 1] are sorted, the rest of the individuals follow in no particular order. The k fittest
+ * are the same sort_population gives.
+ *
+ * @param p population
+ * @param k number of individuals to select
+ * @param total_order break ties of fitness comparing the gnomes (see sort_population)
+ */
+void select_population(Population &p, int k, bool total_order)
+{
+	if (k >= p.size)
+	{
+		sort_population(p, total_order);
+		return;
+	}
+
+	PROFILE_SCOPE(PHASE_SELECTION);
+	p.order.resize(p.size);
+	iota(p.order.begin(), p.order.end(), 0);
+	FitnessOrder less = {p, total_order};
+	nth_element(p.order.begin(), p.order.begin() + k, p.order.end(), less);
+	sort(p.order.begin(), p.order.begin() + k, less);
+}
+
+/**
+ * @brief Order the <k> fittest distinct tours of a population by fitness, first, and then the copies passed over
+ *
+ * Below RADIX_SORT_MIN_SIZE individuals, only as many as needed are ranked (see select_population): the k fittest first
+ * and then, while they hold less than k distinct tours, as many more as the share of copies so far suggests. Copies of
+ * a tour (individuals with the hash of a fitter one) keep their order after the distinct tours, so they only take the
+ * place of a parent if there are less distinct tours than parents. The individuals after them are in no particular
+ * order, unless the whole population is sorted.
+ *
+ * @param p population
+ * @param hashes tour hash of every individual (see tour_hash)
+ * @param k number of distinct tours wanted, p.size to sort the whole population
+ * @param total_order break ties of fitness comparing the gnomes (see sort_population)
+ * @return number of copies put after the distinct tours
+ */
+int sort_unique_population(Population &p, const vector<uint64_t> &hashes, int k, bool total_order)
+{
+	// The radix sort of a whole population is faster than the selection of a part of it
+	int ranked = 0;
+	if (k >= p.size || p.size >= RADIX_SORT_MIN_SIZE)
+	{
+		sort_population(p, total_order);
+		ranked = p.size;
+	}
+	else
+	{
+		p.order.resize(p.size);
+		iota(p.order.begin(), p.order.end(), 0);
+	}
+	PROFILE_SCOPE(PHASE_SELECTION);
+	FitnessOrder less = {p, total_order};
+
+	// Hashes already seen, from the fittest, in an open-addressing table of the scratch memory of the radix sort. Slots
+	// are taken by the high bits of the hash, 0 is an empty slot so hashes are stored with the lowest bit set.
+	size_t slots = 2;
+	int shift = 63;
+	while (slots < 2 * (size_t)p.size)
+		slots <<= 1, shift--;
+	p.keys.assign(slots, 0);
+
+	p.copies.clear();
+	int distinct = 0;
+	for (int r = 0; r < p.size && distinct < k; r++)
+	{
+		if (r == ranked)
+		{
+			// As many as the share of copies so far suggests, and an eighth more, so that few rounds rank the tail again
+			int more = min((long long)p.size - ranked, (long long)(k - distinct) * max(r, 1) / max(distinct, 1) + ranked / 8);
+			auto first = p.order.begin() + ranked, last = first + more;
+			nth_element(first, last, p.order.end(), less);
+			sort(first, last, less);
+			ranked += more;
+		}
+
+		uint64_t hash = hashes[p.order[r]] | 1;
+		size_t slot = hash >> shift;
+		while (p.keys[slot] != 0 && p.keys[slot] != hash)
+			slot = (slot + 1) & (slots - 1);
+
+		if (p.keys[slot] == hash)
+			p.copies.push_back(p.order[r]);
+		else
+		{
+			p.keys[slot] = hash;
+			p.order[distinct++] = p.order[r];
+		}
+	}
+	copy(p.copies.begin(), p.copies.end(), p.order.begin() + distinct);
+	return p.copies.size();
+}
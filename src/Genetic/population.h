@@ -0,0 +1,100 @@
+/**
+ * @file population.h
+ * @author Javier Vela
+ * @brief Header file of the flat population storage of the Genetic Algorithm
+ * @version 0.1
+ * @date 2021-12-12
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef POPULATION_H
+#define POPULATION_H
+
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+#include <vector>
+#include "mpi.h"
+
+/// Genes (cities) of a gnome, compile with -D GENE_16BIT for half the memory on problems up to 65535 cities
+#ifdef GENE_16BIT
+typedef uint16_t gene_t;
+#define MPI_GENE MPI_UNSIGNED_SHORT
+#define MAX_GENE_CITY 65535
+#else
+typedef int32_t gene_t;
+#define MPI_GENE MPI_INT
+#define MAX_GENE_CITY INT32_MAX
+#endif
+
+/// Populations sorted with a parallel radix sort instead of std::sort, from this size on
+#ifndef RADIX_SORT_MIN_SIZE
+#define RADIX_SORT_MIN_SIZE 16384
+#endif
+
+/// Alignment in bytes of every gnome in the population buffer
+#define GNOME_ALIGNMENT 64
+
+/// Allocator of memory aligned to GNOME_ALIGNMENT
+template <typename T>
+struct AlignedAllocator
+{
+	typedef T value_type;
+
+	AlignedAllocator() {}
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U> &) {}
+
+	T *allocate(size_t n)
+	{
+		void *p = NULL;
+		// Padded so vector loads of the last genes do not read past the buffer
+		if (posix_memalign(&p, GNOME_ALIGNMENT, n * sizeof(T) + GNOME_ALIGNMENT) != 0)
+			throw std::bad_alloc();
+		return (T *)p;
+	}
+	void deallocate(T *p, size_t) { free(p); }
+
+	template <typename U>
+	bool operator==(const AlignedAllocator<U> &) const { return true; }
+	template <typename U>
+	bool operator!=(const AlignedAllocator<U> &) const { return false; }
+};
+
+/// Population of individuals, gnomes stored one after the other in a single aligned buffer and fitness in a separate array
+struct Population
+{
+	int size;   // Number of individuals
+	int length; // Genes per gnome
+	int stride; // Genes between the start of two consecutive gnomes (length padded to the alignment)
+	std::vector<gene_t, AlignedAllocator<gene_t>> genes;
+	std::vector<float> fitness;
+	std::vector<int> order; // Individuals sorted by fitness (order[0] is the fittest), valid after sort_population
+	std::vector<uint64_t> keys; // Scratch memory of the radix sort
+	std::vector<int> copies;    // Scratch memory of sort_unique_population
+
+	Population() : size(0), length(0), stride(0) {}
+};
+
+/**
+ * @brief Gnome of individual <i>
+ */
+inline gene_t *gnome(Population &p, int i)
+{
+	return &p.genes[(size_t)i * p.stride];
+}
+
+inline const gene_t *gnome(const Population &p, int i)
+{
+	return &p.genes[(size_t)i * p.stride];
+}
+
+void resize_population(Population &p, int size, int length);
+void append_population(Population &dst, int at, const Population &src);
+void sort_population(Population &p, bool total_order = false);
+void select_population(Population &p, int k, bool total_order = false);
+int sort_unique_population(Population &p, const std::vector<uint64_t> &hashes, int k, bool total_order = false);
+
+#endif /* POPULATION_H */
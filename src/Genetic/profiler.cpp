@@ -0,0 +1,209 @@
+/**
+ * @file profiler.cpp
+ * @author Javier Vela
+ * @brief Source file of the per-phase profiler of the Genetic Algorithm (scoped timers and counters per thread and node)
+ * @version 0.1
+ * @date 2022-01-02
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <set>
+#include "profiler.h"
+#include "mpi.h"
+
+using namespace std;
+
+thread_local ThreadProfile *thread_profile = NULL;
+chrono::steady_clock::time_point profile_origin = chrono::steady_clock::now();
+bool profile_tracing = false;
+
+/// Profiles of every thread that used the profiler, kept between runs as threads keep their pointer
+static vector<unique_ptr<ThreadProfile>> thread_profiles;
+static mutex thread_profiles_mutex;
+static string profile_trace_file;
+
+static const char *phase_names[PHASE_COUNT] = {"initialization", "breeding", "crossover", "mutation", "local search", "pool", "evaluation", "selection", "logging", "encoding", "decoding", "mpi", "migration", "merge", "exact", "bound"};
+static const char *counter_names[COUNTER_COUNT] = {"children", "evaluations", "bytes encoded", "migrants", "cache hits", "duplicates"};
+
+/**
+ * @brief Clear the timers, counters and events of a thread
+ */
+static void reset_thread_profile(ThreadProfile &profile)
+{
+	for (int p = 0; p < PHASE_COUNT; p++)
+		profile.time[p] = profile.calls[p] = 0;
+	for (int c = 0; c < COUNTER_COUNT; c++)
+		profile.counters[c] = 0;
+	profile.events.clear();
+}
+
+/**
+ * @brief Create the profile of the calling thread
+ */
+ThreadProfile &register_thread_profile()
+{
+	lock_guard<mutex> lock(thread_profiles_mutex);
+	thread_profiles.emplace_back(new ThreadProfile());
+	ThreadProfile &profile = *thread_profiles.back();
+	profile.thread = thread_profiles.size() - 1;
+	reset_thread_profile(profile);
+	thread_profile = &profile;
+	return profile;
+}
+
+/**
+ * @brief Start a profile, the clocks of all nodes start at the same barrier. Collective over all nodes.
+ *
+ * @param trace_file where root writes the Chrome trace of all nodes, no events are kept if empty
+ */
+void init_profiler(const string &trace_file)
+{
+	if (!PROFILE)
+		return;
+
+	for (auto &profile : thread_profiles)
+		reset_thread_profile(*profile);
+	profile_trace_file = trace_file;
+	profile_tracing = trace_file != "";
+
+	MPI_Barrier(MPI_COMM_WORLD);
+	profile_origin = chrono::steady_clock::now();
+}
+
+/**
+ * @brief Write the events of all nodes as a Chrome trace (chrome://tracing, Perfetto), one process per node
+ */
+static void write_trace(const vector<ProfileEvent> &events, const vector<int> &counts, int mpi_size)
+{
+	ofstream trace(profile_trace_file);
+	if (!trace)
+	{
+		cerr << "Warning : trace file " << profile_trace_file << " can not be written" << endl;
+		return;
+	}
+
+	trace << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << endl;
+	trace << fixed << setprecision(3);
+	set<pair<int, int>> threads;
+	size_t e = 0;
+	for (int r = 0; r < mpi_size; r++)
+	{
+		trace << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << r << ",\"args\":{\"name\":\"node " << r << "\"}}," << endl;
+		for (int i = 0; i < counts[r]; i++, e++)
+		{
+			const ProfileEvent &event = events[e];
+			threads.insert({r, event.thread});
+			trace << "{\"name\":\"" << phase_names[event.phase] << "\",\"ph\":\"X\",\"pid\":" << r << ",\"tid\":" << event.thread
+				  << ",\"ts\":" << event.begin / 1e3 << ",\"dur\":" << (event.end - event.begin) / 1e3 << "}," << endl;
+		}
+	}
+	for (auto &thread : threads)
+		trace << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << thread.first << ",\"tid\":" << thread.second
+			  << ",\"args\":{\"name\":\"thread " << thread.second << "\"}}," << endl;
+
+	// Metadata event so the list does not end in a comma
+	trace << "{\"name\":\"profile\",\"ph\":\"M\",\"pid\":0,\"args\":{\"nodes\":" << mpi_size << "}}" << endl;
+	trace << "]}" << endl;
+}
+
+/**
+ * @brief Print the summary of the profile of all nodes to stderr, and write the trace if one was requested. Collective
+ * over all nodes, every thread must have finished its phases.
+ *
+ * @param mpi_rank MPI rank of current node
+ * @param mpi_size MPI size
+ * @param mpi_root MPI rank of the root node
+ */
+void report_profile(int mpi_rank, int mpi_size, int mpi_root)
+{
+	if (!PROFILE)
+		return;
+
+	// Times (milliseconds), calls and counters of the node, added over its threads
+	const int fields = 2 * PHASE_COUNT + COUNTER_COUNT;
+	vector<double> node(fields, 0);
+	vector<ProfileEvent> events;
+	for (auto &profile : thread_profiles)
+	{
+		for (int p = 0; p < PHASE_COUNT; p++)
+		{
+			node[p] += profile->time[p] / 1e6;
+			node[PHASE_COUNT + p] += profile->calls[p];
+		}
+		for (int c = 0; c < COUNTER_COUNT; c++)
+			node[2 * PHASE_COUNT + c] += profile->counters[c];
+		events.insert(events.end(), profile->events.begin(), profile->events.end());
+	}
+
+	vector<double> nodes(mpi_rank == mpi_root ? fields * mpi_size : 0);
+	MPI_Gather(node.data(), fields, MPI_DOUBLE, nodes.data(), fields, MPI_DOUBLE, mpi_root, MPI_COMM_WORLD);
+
+	if (mpi_rank == mpi_root)
+	{
+		cerr << "Profile (milliseconds added over the threads of a node, a phase includes the phases nested in it)" << endl;
+		cerr << left << setw(16) << "Phase" << right << setw(12) << "Calls" << setw(14) << "Mean node" << setw(14) << "Max node" << setw(10) << "Slowest" << endl;
+		cerr << fixed << setprecision(3);
+		for (int p = 0; p < PHASE_COUNT; p++)
+		{
+			double calls = 0, total = 0;
+			int slowest = 0;
+			for (int r = 0; r < mpi_size; r++)
+			{
+				calls += nodes[r * fields + PHASE_COUNT + p];
+				total += nodes[r * fields + p];
+				if (nodes[r * fields + p] > nodes[slowest * fields + p])
+					slowest = r;
+			}
+			if (calls == 0)
+				continue;
+			cerr << left << setw(16) << phase_names[p] << right << setw(12) << (long long)calls << setw(14) << total / mpi_size
+				 << setw(14) << nodes[slowest * fields + p] << setw(10) << slowest << endl;
+		}
+		cerr << left << setw(16) << "Counter" << right << setw(12) << "Total" << setw(14) << "Mean node" << setw(14) << "Max node" << setw(10) << "Node" << endl;
+		for (int c = 0; c < COUNTER_COUNT; c++)
+		{
+			double total = 0;
+			int most = 0;
+			for (int r = 0; r < mpi_size; r++)
+			{
+				total += nodes[r * fields + 2 * PHASE_COUNT + c];
+				if (nodes[r * fields + 2 * PHASE_COUNT + c] > nodes[most * fields + 2 * PHASE_COUNT + c])
+					most = r;
+			}
+			cerr << left << setw(16) << counter_names[c] << right << setw(12) << (long long)total << setw(14) << (long long)(total / mpi_size)
+				 << setw(14) << (long long)nodes[most * fields + 2 * PHASE_COUNT + c] << setw(10) << most << endl;
+		}
+		cerr << defaultfloat;
+	}
+
+	if (!profile_tracing)
+		return;
+
+	// Events of every node gathered by root, counted in events (at most PROFILE_MAX_EVENTS per node) instead of bytes
+	MPI_Datatype event_type;
+	MPI_Type_contiguous(sizeof(ProfileEvent), MPI_BYTE, &event_type);
+	MPI_Type_commit(&event_type);
+
+	int count = events.size();
+	vector<int> counts(mpi_size), displacements(mpi_size, 0);
+	MPI_Gather(&count, 1, MPI_INT, counts.data(), 1, MPI_INT, mpi_root, MPI_COMM_WORLD);
+	vector<ProfileEvent> all;
+	if (mpi_rank == mpi_root)
+	{
+		for (int r = 1; r < mpi_size; r++)
+			displacements[r] = displacements[r - 1] + counts[r - 1];
+		all.resize(displacements[mpi_size - 1] + counts[mpi_size - 1]);
+	}
+	MPI_Gatherv(events.data(), count, event_type, all.data(), counts.data(), displacements.data(), event_type, mpi_root, MPI_COMM_WORLD);
+	MPI_Type_free(&event_type);
+
+	if (mpi_rank == mpi_root)
+		write_trace(all, counts, mpi_size);
+}
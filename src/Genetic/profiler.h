@@ -0,0 +1,138 @@
+/**
+ * @file profiler.h
+ * @author Javier Vela
+ * @brief Header file of the per-phase profiler of the Genetic Algorithm (scoped timers and counters per thread and node)
+ * @version 0.1
+ * @date 2022-01-02
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+/// Time the phases of the algorithm (make PROFILE=1), every macro below compiles to nothing otherwise
+#ifndef PROFILE
+#define PROFILE 0
+#endif
+
+/// Events kept per thread for the trace, later ones are only added to the summary
+#ifndef PROFILE_MAX_EVENTS
+#define PROFILE_MAX_EVENTS (1 << 20)
+#endif
+
+#include <cstdint>
+#include <chrono>
+#include <string>
+#include <vector>
+
+/// Phases timed by the profiler, nested phases are also included in the phase around them
+enum ProfilePhase
+{
+	PHASE_INITIALIZATION, // Initial gnomes built by a thread
+	PHASE_BREEDING,       // Children bred by a thread (generation or steady-state batch)
+	PHASE_CROSSOVER,      // Crossover of a child (summary only)
+	PHASE_MUTATION,       // Mutations of a child (summary only)
+	PHASE_LOCAL_SEARCH,   // Local search of a child or the elite (summary only)
+	PHASE_POOL,           // Parents taken from and children put in the steady-state pool (summary only)
+	PHASE_EVALUATION,     // Full evaluation of a batch of tours
+	PHASE_SELECTION,      // Sorting or selecting a population
+	PHASE_LOGGING,        // Printing the best individual
+	PHASE_ENCODING,       // Tours encoded for other nodes
+	PHASE_DECODING,       // Tours decoded from other nodes
+	PHASE_MPI,            // MPI calls that may wait for other nodes
+	PHASE_MIGRATION,      // Migrants sent and received
+	PHASE_MERGE,          // Individuals received merged into the population
+	PHASE_EXACT,          // Small problem solved by the exact solver
+	PHASE_BOUND,          // Lower bound of the optimal tour
+	PHASE_COUNT
+};
+
+/// Counters of the profiler, added over all threads
+enum ProfileCounter
+{
+	COUNTER_CHILDREN,    // Children bred
+	COUNTER_EVALUATIONS, // Tours fully evaluated
+	COUNTER_BYTES,       // Bytes of tours encoded for other nodes
+	COUNTER_MIGRANTS,    // Migrants merged into the population
+	COUNTER_CACHE_HITS,  // Tours whose fitness was found in the fitness cache
+	COUNTER_DUPLICATES,  // Copies of a tour put after the distinct tours by the selection
+	COUNTER_COUNT
+};
+
+/// Interval of a phase in a thread, nanoseconds since the start of the profile
+struct ProfileEvent
+{
+	int32_t thread, phase;
+	int64_t begin, end;
+};
+
+/// Timers and counters of one thread, on its own cache lines
+struct alignas(64) ThreadProfile
+{
+	int thread;                           // Index of the thread in the node, in order of first use
+	int64_t time[PHASE_COUNT];            // Nanoseconds in every phase
+	int64_t calls[PHASE_COUNT];
+	int64_t counters[COUNTER_COUNT];
+	std::vector<ProfileEvent> events;     // Intervals of the traced phases
+};
+
+ThreadProfile &register_thread_profile();
+void init_profiler(const std::string &trace_file);
+void report_profile(int mpi_rank, int mpi_size, int mpi_root);
+
+/// Profile of the calling thread, registered the first time it is used
+extern thread_local ThreadProfile *thread_profile;
+/// Start of the profile of the node and whether trace events are kept
+extern std::chrono::steady_clock::time_point profile_origin;
+extern bool profile_tracing;
+
+inline ThreadProfile &current_profile()
+{
+	return thread_profile ? *thread_profile : register_thread_profile();
+}
+
+inline int64_t profile_clock()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - profile_origin).count();
+}
+
+/**
+ * @brief Time the phase from its construction to the end of its scope
+ */
+class ProfileScope
+{
+	ProfilePhase phase;
+	int64_t begin;
+
+public:
+	ProfileScope(ProfilePhase phase) : phase(phase), begin(profile_clock()) {}
+
+	~ProfileScope()
+	{
+		int64_t end = profile_clock();
+		ThreadProfile &profile = current_profile();
+		profile.time[phase] += end - begin;
+		profile.calls[phase]++;
+
+		// Phases timed for every child are too many to trace
+		bool traced = phase != PHASE_CROSSOVER && phase != PHASE_MUTATION && phase != PHASE_LOCAL_SEARCH && phase != PHASE_POOL;
+		if (profile_tracing && traced && profile.events.size() < PROFILE_MAX_EVENTS)
+			profile.events.push_back({profile.thread, phase, begin, end});
+	}
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#if PROFILE
+#define PROFILE_SCOPE(phase) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(phase)
+#define PROFILE_COUNT(counter, n) (current_profile().counters[counter] += (n))
+#else
+#define PROFILE_SCOPE(phase)
+// The count is not evaluated, but the variables it names are still used
+#define PROFILE_COUNT(counter, n) ((void)sizeof(n))
+#endif
+
+#endif /* PROFILER_H */
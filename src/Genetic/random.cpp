@@ -0,0 +1,99 @@
+/**
+ * @file random.cpp
+ * @author Javier Vela
+ * @brief Source file of the random number streams of the Genetic Algorithm (xoshiro256** with jump-ahead)
+ * @version 0.1
+ * @date 2021-12-14
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include "random.h"
+
+/**
+ * @brief Initialize a generator out of a 64 bit seed
+ *
+ * @param rng generator
+ * @param seed seed
+ */
+void seed_rng(Rng &rng, uint64_t seed)
+{
+	uint64_t x = seed;
+	for (int i = 0; i < 4; i++)
+		rng.s[i] = splitmix64(x);
+}
+
+/**
+ * @brief Advance a generator 2^128 numbers, equivalent to that many calls to next_rng
+ *
+ * @param rng generator
+ */
+void jump_rng(Rng &rng)
+{
+	static const uint64_t JUMP[] = {0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+
+	uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		for (int b = 0; b < 64; b++)
+		{
+			if (JUMP[i] & (1ULL << b))
+			{
+				s0 ^= rng.s[0];
+				s1 ^= rng.s[1];
+				s2 ^= rng.s[2];
+				s3 ^= rng.s[3];
+			}
+			next_rng(rng);
+		}
+	}
+
+	rng.s[0] = s0;
+	rng.s[1] = s1;
+	rng.s[2] = s2;
+	rng.s[3] = s3;
+}
+
+/**
+ * @brief Independent stream <stream> of the sequence of <seed>, streams never overlap (2^128 numbers apart)
+ *
+ * @param seed seed of the sequence
+ * @param stream stream number (for example MPI rank * threads + thread)
+ * @return generator positioned at the start of the stream
+ */
+Rng stream_rng(uint64_t seed, uint64_t stream)
+{
+	Rng rng;
+	seed_rng(rng, seed);
+	for (uint64_t i = 0; i < stream; i++)
+		jump_rng(rng);
+	return rng;
+}
+
+/**
+ * @brief Counter-based generator, its numbers only depend on the seed and the counter (<a>, <b>, <c>)
+ *
+ * Used by the deterministic mode so the numbers of a task do not depend on which thread executes it
+ *
+ * @param seed seed of the run
+ * @param a first counter (for example MPI rank)
+ * @param b second counter (for example generation)
+ * @param c third counter (for example member of the population)
+ * @return generator for the counter
+ */
+Rng counter_rng(uint64_t seed, uint64_t a, uint64_t b, uint64_t c)
+{
+	uint64_t x = seed;
+	uint64_t key = splitmix64(x);
+	x = key ^ a;
+	key = splitmix64(x);
+	x = key ^ b;
+	key = splitmix64(x);
+	x = key ^ c;
+
+	Rng rng;
+	for (int i = 0; i < 4; i++)
+		rng.s[i] = splitmix64(x);
+	return rng;
+}
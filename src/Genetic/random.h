@@ -0,0 +1,85 @@
+/**
+ * @file random.h
+ * @author Javier Vela
+ * @brief Header file of the random number streams of the Genetic Algorithm (xoshiro256** with jump-ahead)
+ * @version 0.1
+ * @date 2021-12-14
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <cstdint>
+
+/// State of a xoshiro256** generator, aligned to its own cache line so per-thread states do not share lines
+struct alignas(64) Rng
+{
+	uint64_t s[4];
+};
+
+/**
+ * @brief Next 64 bits of a splitmix64 sequence, used to expand seeds and hash counters
+ */
+inline uint64_t splitmix64(uint64_t &x)
+{
+	uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+inline uint64_t rotl(const uint64_t x, int k)
+{
+	return (x << k) | (x >> (64 - k));
+}
+
+/**
+ * @brief Next 64 random bits of a generator
+ */
+inline uint64_t next_rng(Rng &rng)
+{
+	uint64_t *s = rng.s;
+	const uint64_t result = rotl(s[1] * 5, 7) * 9;
+	const uint64_t t = s[1] << 17;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl(s[3], 45);
+
+	return result;
+}
+
+/**
+ * @brief Function to return a random number from start and end
+ *
+ * @param rng generator
+ * @param start lower limit
+ * @param end upper limit (excluded)
+ * @return random integer
+ */
+inline int rand_num(Rng &rng, int start, int end)
+{
+	uint64_t r = (uint64_t)(end - start);
+	return start + (int)(((next_rng(rng) >> 32) * r) >> 32);
+}
+
+/**
+ * @brief Random double in [0, 1)
+ */
+inline double rand_unit(Rng &rng)
+{
+	return (next_rng(rng) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+void seed_rng(Rng &rng, uint64_t seed);
+void jump_rng(Rng &rng);
+Rng stream_rng(uint64_t seed, uint64_t stream);
+Rng counter_rng(uint64_t seed, uint64_t a, uint64_t b, uint64_t c);
+
+#endif /* RANDOM_H */
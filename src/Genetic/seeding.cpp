@@ -0,0 +1,394 @@
+/**
+ * @file seeding.cpp
+ * @author Javier Vela
+ * @brief Source file of the construction heuristics used to seed the initial population of the Genetic Algorithm
+ * @version 0.1
+ * @date 2021-12-20
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <algorithm>
+#include <cfloat>
+#include "seeding.h"
+#include "distance.h"
+
+using namespace std;
+
+/// Bits per coordinate of the grid the space-filling curve goes through
+#define HILBERT_ORDER 16
+
+/**
+ * @brief Heuristic of the <seed_index>-th seeded gnome of the whole population
+ *
+ * The deterministic heuristics would only produce copies of the same tour, so each one seeds a single gnome and the
+ * rest are nearest neighbour tours from random start cities.
+ */
+SeedHeuristic seed_heuristic(int seed_index)
+{
+	return seed_index < SEED_NEAREST_NEIGHBOUR ? (SeedHeuristic)seed_index : SEED_NEAREST_NEIGHBOUR;
+}
+
+static inline bool indexed(Map &tsp)
+{
+	return tsp.index.n == tsp.dimension;
+}
+
+/**
+ * @brief Make every city available to nearest_available
+ */
+static void reset_available(Map &tsp, Seeding &seeding)
+{
+	if (indexed(tsp))
+		initKdTreeMask(tsp.index, seeding.mask);
+	else
+		seeding.used.assign(tsp.dimension + 1, 0);
+}
+
+static inline bool available(Map &tsp, Seeding &seeding, int city)
+{
+	return indexed(tsp) ? !seeding.mask.removed[tsp.index.slot[city]] : !seeding.used[city];
+}
+
+static inline void take(Map &tsp, Seeding &seeding, int city)
+{
+	if (indexed(tsp))
+		removeKdTreeCity(tsp.index, seeding.mask, city);
+	else
+		seeding.used[city] = 1;
+}
+
+/**
+ * @brief Available city nearest to <from>, through the spatial index if the problem has one
+ *
+ * @return nearest available city, 0 if none is left
+ */
+static int nearest_available(Map &tsp, Seeding &seeding, int from)
+{
+	if (indexed(tsp))
+		return nearestRemaining(tsp.index, seeding.mask, indexPoint(tsp, from));
+
+	int best = 0;
+	float best_distance = FLT_MAX;
+	for (int c = 1; c <= tsp.dimension; c++)
+	{
+		if (seeding.used[c])
+			continue;
+		float d = getDistance(tsp, from, c);
+		if (d < best_distance)
+		{
+			best_distance = d;
+			best = c;
+		}
+	}
+	return best;
+}
+
+static int find_component(Seeding &seeding, int city)
+{
+	while (seeding.component[city] != city)
+	{
+		seeding.component[city] = seeding.component[seeding.component[city]];
+		city = seeding.component[city];
+	}
+	return city;
+}
+
+/**
+ * @brief Collect the edges between every city and its candidate neighbours, sorted by length, and reset the components
+ */
+static void candidate_edges(Map &tsp, Seeding &seeding)
+{
+	seeding.edges.clear();
+	for (int i = 1; i <= tsp.dimension; i++)
+	{
+		for (int k = 0; k < tsp.neighbourK; k++)
+		{
+			int j = tsp.neighbours[(size_t)i * tsp.neighbourK + k];
+			seeding.edges.push_back(make_pair(tsp.neighbourDistance[(size_t)i * tsp.neighbourK + k], make_pair(min(i, j), max(i, j))));
+		}
+	}
+	sort(seeding.edges.begin(), seeding.edges.end());
+	seeding.edges.erase(unique(seeding.edges.begin(), seeding.edges.end()), seeding.edges.end());
+
+	seeding.component.resize(tsp.dimension + 1);
+	for (int c = 0; c <= tsp.dimension; c++)
+		seeding.component[c] = c;
+	seeding.degree.assign(tsp.dimension + 1, 0);
+}
+
+/**
+ * @brief Nearest neighbour tour: start at a random city and always go to the nearest city not visited yet
+ */
+static void nearest_neighbour_tour(gene_t *gnome, Map &tsp, Rng &rng, Seeding &seeding)
+{
+	int n = tsp.dimension;
+	reset_available(tsp, seeding);
+
+	gnome[0] = rand_num(rng, 1, n + 1);
+	take(tsp, seeding, gnome[0]);
+	for (int i = 1; i < n; i++)
+	{
+		gnome[i] = nearest_available(tsp, seeding, gnome[i - 1]);
+		take(tsp, seeding, gnome[i]);
+	}
+}
+
+/**
+ * @brief Write the path of the partial solution that goes from <from> to <to> at gnome[pos...]
+ */
+static void write_path(gene_t *gnome, int &pos, Seeding &seeding, int from, int to)
+{
+	int prev = 0, c = from;
+	while (true)
+	{
+		gnome[pos++] = c;
+		if (c == to)
+			return;
+		int next = seeding.adjacent[2 * c] != prev ? seeding.adjacent[2 * c] : seeding.adjacent[2 * c + 1];
+		prev = c;
+		c = next;
+	}
+}
+
+/**
+ * @brief Greedy edge tour: add the shortest candidate edges that keep every city with degree up to 2 and no cycles,
+ * then join the resulting paths, going from the end of each one to the nearest end of another
+ */
+static void greedy_edge_tour(gene_t *gnome, Map &tsp, Seeding &seeding)
+{
+	int n = tsp.dimension;
+	candidate_edges(tsp, seeding);
+	seeding.adjacent.assign(2 * (n + 1), 0);
+
+	for (auto &edge : seeding.edges)
+	{
+		int i = edge.second.first, j = edge.second.second;
+		if (seeding.degree[i] == 2 || seeding.degree[j] == 2)
+			continue;
+		int ci = find_component(seeding, i), cj = find_component(seeding, j);
+		if (ci == cj)
+			continue;
+		seeding.component[ci] = cj;
+		seeding.adjacent[2 * i + seeding.degree[i]++] = j;
+		seeding.adjacent[2 * j + seeding.degree[j]++] = i;
+	}
+
+	// Other end of the path of every end city
+	vector<int> other(n + 1, 0);
+	for (int c = 1; c <= n; c++)
+	{
+		if (seeding.degree[c] == 2 || other[c] != 0)
+			continue;
+		int prev = 0, e = c;
+		while (seeding.degree[e] == 2 || prev == 0)
+		{
+			int next = seeding.adjacent[2 * e] != prev ? seeding.adjacent[2 * e] : seeding.adjacent[2 * e + 1];
+			if (next == 0)
+				break;
+			prev = e;
+			e = next;
+		}
+		other[c] = e;
+		other[e] = c;
+	}
+
+	// Only the ends of the paths are looked for
+	reset_available(tsp, seeding);
+	int start = 0;
+	for (int c = 1; c <= n; c++)
+	{
+		if (seeding.degree[c] == 2)
+			take(tsp, seeding, c);
+		else if (start == 0)
+			start = c;
+	}
+
+	int pos = 0, from = start;
+	while (true)
+	{
+		int to = other[from];
+		take(tsp, seeding, from);
+		take(tsp, seeding, to);
+		write_path(gnome, pos, seeding, from, to);
+		if (pos == n)
+			return;
+		from = nearest_available(tsp, seeding, to);
+	}
+}
+
+/**
+ * @brief Christofides-like tour: minimum spanning tree over the candidate edges, greedy nearest neighbour matching of
+ * its odd degree cities instead of the minimum weight perfect matching, Eulerian circuit and shortcut of repeated cities
+ */
+static void christofides_tour(gene_t *gnome, Map &tsp, Seeding &seeding)
+{
+	int n = tsp.dimension;
+	candidate_edges(tsp, seeding);
+
+	// Kruskal over the candidate edges
+	vector<pair<int, int>> graph;
+	graph.reserve(2 * n);
+	for (auto &edge : seeding.edges)
+	{
+		int i = edge.second.first, j = edge.second.second;
+		int ci = find_component(seeding, i), cj = find_component(seeding, j);
+		if (ci == cj)
+			continue;
+		seeding.component[ci] = cj;
+		graph.push_back(edge.second);
+	}
+
+	// Candidate graphs of clustered problems may be disconnected, their components are joined through city 1
+	for (int c = 2; c <= n; c++)
+	{
+		int cc = find_component(seeding, c), c1 = find_component(seeding, 1);
+		if (cc != c1)
+		{
+			seeding.component[cc] = c1;
+			graph.push_back(make_pair(1, c));
+		}
+	}
+	for (auto &edge : graph)
+	{
+		seeding.degree[edge.first]++;
+		seeding.degree[edge.second]++;
+	}
+
+	// Odd degree cities matched with the nearest odd degree city left
+	reset_available(tsp, seeding);
+	for (int c = 1; c <= n; c++)
+		if (seeding.degree[c] % 2 == 0)
+			take(tsp, seeding, c);
+	for (int c = 1; c <= n; c++)
+	{
+		if (seeding.degree[c] % 2 == 0 || !available(tsp, seeding, c))
+			continue;
+		take(tsp, seeding, c);
+		int mate = nearest_available(tsp, seeding, c);
+		take(tsp, seeding, mate);
+		graph.push_back(make_pair(c, mate));
+	}
+
+	// Adjacency of the multigraph (every degree is even now)
+	vector<int> first(n + 2, 0), incident(2 * graph.size());
+	for (auto &edge : graph)
+	{
+		first[edge.first + 1]++;
+		first[edge.second + 1]++;
+	}
+	for (int c = 1; c <= n + 1; c++)
+		first[c] += first[c - 1];
+	vector<int> next_incident(first.begin(), first.end() - 1);
+	for (int e = 0; e < (int)graph.size(); e++)
+	{
+		incident[next_incident[graph[e].first]++] = e;
+		incident[next_incident[graph[e].second]++] = e;
+	}
+
+	// Hierholzer, the circuit comes out backwards and every city is written the first time it appears
+	vector<char> edge_used(graph.size(), 0), visited(n + 1, 0);
+	vector<int> stack(1, 1);
+	vector<int> cursor(first.begin(), first.end() - 1);
+	int pos = 0;
+	while (!stack.empty())
+	{
+		int c = stack.back();
+		while (cursor[c] < first[c + 1] && edge_used[incident[cursor[c]]])
+			cursor[c]++;
+		if (cursor[c] == first[c + 1])
+		{
+			stack.pop_back();
+			if (!visited[c])
+			{
+				visited[c] = 1;
+				gnome[pos++] = c;
+			}
+			continue;
+		}
+		int e = incident[cursor[c]];
+		edge_used[e] = 1;
+		stack.push_back(graph[e].first == c ? graph[e].second : graph[e].first);
+	}
+}
+
+/**
+ * @brief Distance along a Hilbert curve of side <side> (power of 2) to the point (x, y) of its grid
+ */
+static uint64_t hilbert_distance(uint32_t side, uint32_t x, uint32_t y)
+{
+	uint64_t d = 0;
+	for (uint32_t s = side / 2; s > 0; s /= 2)
+	{
+		uint32_t rx = (x & s) > 0, ry = (y & s) > 0;
+		d += (uint64_t)s * s * ((3 * rx) ^ ry);
+		if (ry == 0)
+		{
+			if (rx == 1)
+			{
+				x = side - 1 - x;
+				y = side - 1 - y;
+			}
+			swap(x, y);
+		}
+	}
+	return d;
+}
+
+/**
+ * @brief Space-filling curve tour: cities in the order a Hilbert curve over their bounding box goes through them
+ */
+static void space_filling_curve_tour(gene_t *gnome, Map &tsp)
+{
+	int n = tsp.dimension;
+	double min_x = *min_element(tsp.x + 1, tsp.x + n + 1), max_x = *max_element(tsp.x + 1, tsp.x + n + 1);
+	double min_y = *min_element(tsp.y + 1, tsp.y + n + 1), max_y = *max_element(tsp.y + 1, tsp.y + n + 1);
+	uint32_t side = 1u << HILBERT_ORDER;
+	double scale = (side - 1) / max(max(max_x - min_x, max_y - min_y), DBL_MIN);
+
+	vector<pair<uint64_t, int>> keys(n);
+	for (int c = 1; c <= n; c++)
+		keys[c - 1] = make_pair(hilbert_distance(side, (uint32_t)((tsp.x[c] - min_x) * scale), (uint32_t)((tsp.y[c] - min_y) * scale)), c);
+	sort(keys.begin(), keys.end());
+
+	for (int i = 0; i < n; i++)
+		gnome[i] = keys[i].second;
+}
+
+/**
+ * @brief Build a gnome with a construction heuristic
+ *
+ * Greedy edge and Christofides need the neighbour cache of the problem, and the space-filling curve its coordinates;
+ * problems without them get nearest neighbour tours instead.
+ *
+ * @param gnome where to write the gnome
+ * @param tsp TSP problem object
+ * @param heuristic construction heuristic
+ * @param rng random number generator of the calling thread (start city of nearest neighbour tours)
+ * @param seeding scratch memory of the calling thread
+ */
+void seed_gnome(gene_t *gnome, Map &tsp, SeedHeuristic heuristic, Rng &rng, Seeding &seeding)
+{
+	if (tsp.dimension < 4)
+		heuristic = SEED_NEAREST_NEIGHBOUR;
+	if ((heuristic == SEED_GREEDY_EDGE || heuristic == SEED_CHRISTOFIDES) && tsp.neighbourK == 0)
+		heuristic = SEED_NEAREST_NEIGHBOUR;
+	if (heuristic == SEED_SPACE_FILLING_CURVE && tsp.edgeWeightType == EXPLICIT)
+		heuristic = SEED_NEAREST_NEIGHBOUR;
+
+	switch (heuristic)
+	{
+	case SEED_GREEDY_EDGE:
+		greedy_edge_tour(gnome, tsp, seeding);
+		break;
+	case SEED_CHRISTOFIDES:
+		christofides_tour(gnome, tsp, seeding);
+		break;
+	case SEED_SPACE_FILLING_CURVE:
+		space_filling_curve_tour(gnome, tsp);
+		break;
+	default:
+		nearest_neighbour_tour(gnome, tsp, rng, seeding);
+	}
+}
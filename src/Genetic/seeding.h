@@ -0,0 +1,43 @@
+/**
+ * @file seeding.h
+ * @author Javier Vela
+ * @brief Header file of the construction heuristics used to seed the initial population of the Genetic Algorithm
+ * @version 0.1
+ * @date 2021-12-20
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef SEEDING_H
+#define SEEDING_H
+
+#include <vector>
+#include "tsplib.h"
+#include "population.h"
+#include "random.h"
+
+/// Construction heuristic of a seeded gnome
+enum SeedHeuristic
+{
+	SEED_GREEDY_EDGE,
+	SEED_CHRISTOFIDES,
+	SEED_SPACE_FILLING_CURVE,
+	SEED_NEAREST_NEIGHBOUR // From a random start city, the only heuristic that gives a different tour every time
+};
+
+/// Scratch memory of the construction heuristics, one per thread so several gnomes are seeded concurrently
+struct Seeding
+{
+	KdTreeMask mask;              // Cities still available for nearest neighbour queries
+	std::vector<char> used;       // Visited flags (problems without spatial index)
+	std::vector<int> degree;      // Degree of every city in the partial solution
+	std::vector<int> adjacent;    // Up to two neighbours of every city in the partial solution (0 if none)
+	std::vector<int> component;   // Union-find parent of every city
+	std::vector<std::pair<float, std::pair<int, int>>> edges; // Candidate edges sorted by length
+};
+
+SeedHeuristic seed_heuristic(int seed_index);
+void seed_gnome(gene_t *gnome, Map &tsp, SeedHeuristic heuristic, Rng &rng, Seeding &seeding);
+
+#endif /* SEEDING_H */
@@ -0,0 +1,143 @@
+/**
+ * @file steady.cpp
+ * @author Javier Vela
+ * @brief Source file of the sharded pool of the steady-state Genetic Algorithm, bred by all threads without barriers
+ * @version 0.1
+ * @date 2021-12-31
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <algorithm>
+#include <cstring>
+#include "steady.h"
+#include "profiler.h"
+
+using namespace std;
+
+/**
+ * @brief Find the least fit individual of a shard (lock held)
+ */
+static void update_worst(SteadyPool &pool, PoolShard &shard)
+{
+	const float *fitness = pool.population->fitness.data();
+	int worst = shard.first;
+	for (int i = shard.first + 1; i < shard.first + shard.size; i++)
+		if (fitness[i] > fitness[worst])
+			worst = i;
+	shard.worst = worst;
+}
+
+/**
+ * @brief Split a population into shards of consecutive individuals, at least one per thread
+ *
+ * @param pool pool to initialize
+ * @param population population of the pool, not resized while the pool is in use
+ * @param threads threads breeding in the pool (at most one per individual)
+ * @param tournament individuals compared to select each parent, at least TOURNAMENT_SIZE
+ */
+void init_pool(SteadyPool &pool, Population &population, int threads, int tournament)
+{
+	threads = max(1, min(threads, population.size));
+	int shards = max(threads, population.size / POOL_SHARD_SIZE);
+	pool.threads = threads;
+	pool.tournament = max(TOURNAMENT_SIZE, tournament);
+	pool.population = &population;
+	pool.shards = vector<PoolShard>(shards);
+	for (int s = 0; s < shards; s++)
+	{
+		PoolShard &shard = pool.shards[s];
+		omp_init_lock(&shard.lock);
+		shard.first = (int)((long long)population.size * s / shards);
+		shard.size = (int)((long long)population.size * (s + 1) / shards) - shard.first;
+		update_worst(pool, shard);
+	}
+}
+
+/**
+ * @brief Release the locks of a pool
+ */
+void free_pool(SteadyPool &pool)
+{
+	for (PoolShard &shard : pool.shards)
+		omp_destroy_lock(&shard.lock);
+	pool.shards.clear();
+}
+
+/**
+ * @brief Fitness of a random individual of a random shard, read without the lock of the shard
+ *
+ * @param individual where to write the individual
+ * @return shard of the individual
+ */
+static PoolShard &random_entrant(SteadyPool &pool, Rng &rng, int &individual, float &fitness)
+{
+	PoolShard &shard = pool.shards[rand_num(rng, 0, pool.shards.size())];
+	individual = shard.first + rand_num(rng, 0, shard.size);
+	float *entrant = &pool.population->fitness[individual];
+#pragma omp atomic read
+	fitness = *entrant;
+	return shard;
+}
+
+/**
+ * @brief Copy a parent chosen by a tournament of individuals of random shards
+ *
+ * The entrants come from the whole pool, so the selection pressure is the one of the tournament size, not of the few
+ * individuals of a shard. The winner may have been replaced since it was compared, its replacement is copied then.
+ *
+ * @param pool pool
+ * @param rng random number generator of the calling thread
+ * @param parent where to copy the gnome of the parent
+ * @return fitness of the parent
+ */
+float select_parent(SteadyPool &pool, Rng &rng, gene_t *parent)
+{
+	PROFILE_SCOPE(PHASE_POOL);
+	Population &population = *pool.population;
+	int best, other;
+	float best_fitness, other_fitness;
+	PoolShard *shard = &random_entrant(pool, rng, best, best_fitness);
+	for (int t = 1; t < pool.tournament; t++)
+	{
+		PoolShard &other_shard = random_entrant(pool, rng, other, other_fitness);
+		if (other_fitness < best_fitness)
+			best = other, best_fitness = other_fitness, shard = &other_shard;
+	}
+
+	omp_set_lock(&shard->lock);
+	memcpy(parent, gnome(population, best), population.length * sizeof(gene_t));
+	float fitness = population.fitness[best];
+	omp_unset_lock(&shard->lock);
+
+	return fitness;
+}
+
+/**
+ * @brief Replace the least fit individual of a random shard of <thread> by a child if the child is fitter
+ *
+ * @return true if the child entered the pool
+ */
+bool replace_worst(SteadyPool &pool, int thread, Rng &rng, const gene_t *child, float fitness)
+{
+	PROFILE_SCOPE(PHASE_POOL);
+	Population &population = *pool.population;
+	thread %= pool.threads;
+	int owned = ((int)pool.shards.size() - thread + pool.threads - 1) / pool.threads;
+	PoolShard &shard = pool.shards[thread + rand_num(rng, 0, owned) * pool.threads];
+
+	omp_set_lock(&shard.lock);
+	bool replaced = fitness < population.fitness[shard.worst];
+	if (replaced)
+	{
+		memcpy(gnome(population, shard.worst), child, population.length * sizeof(gene_t));
+		float *worst = &population.fitness[shard.worst];
+#pragma omp atomic write
+		*worst = fitness;
+		update_worst(pool, shard);
+	}
+	omp_unset_lock(&shard.lock);
+
+	return replaced;
+}
@@ -0,0 +1,58 @@
+/**
+ * @file steady.h
+ * @author Javier Vela
+ * @brief Header file of the sharded pool of the steady-state Genetic Algorithm, bred by all threads without barriers
+ * @version 0.1
+ * @date 2021-12-31
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef STEADY_H
+#define STEADY_H
+
+#include <vector>
+#include "population.h"
+#include "random.h"
+#include "omp.h"
+
+/// Fewest individuals compared to select each parent (tournament selection), CHILD_PER_GNOME if more
+#ifndef TOURNAMENT_SIZE
+#define TOURNAMENT_SIZE 2
+#endif
+
+/// Individuals per shard of the pool, at least (the least fit of a shard is searched after every replacement)
+#ifndef POOL_SHARD_SIZE
+#define POOL_SHARD_SIZE 64
+#endif
+
+/// Contiguous range of individuals of the pool, guarded by its own lock and on its own cache line
+struct alignas(64) PoolShard
+{
+	omp_lock_t lock;
+	int first, size; // Individuals first ... first + size - 1 of the population
+	int worst;       // Least fit individual of the shard
+};
+
+/**
+ * @brief Population shared by the threads of the steady-state algorithm
+ *
+ * Parents are selected by tournaments across all shards and children replace the least fit individual of a shard of their thread (shards
+ * t, t + threads, t + 2 * threads ...), so threads only wait for each other when they touch the same shard at the same
+ * time.
+ */
+struct SteadyPool
+{
+	Population *population;
+	std::vector<PoolShard> shards;
+	int threads;    // Threads breeding in the pool
+	int tournament; // Individuals compared to select each parent
+};
+
+void init_pool(SteadyPool &pool, Population &population, int threads, int tournament);
+void free_pool(SteadyPool &pool);
+float select_parent(SteadyPool &pool, Rng &rng, gene_t *parent);
+bool replace_worst(SteadyPool &pool, int thread, Rng &rng, const gene_t *child, float fitness);
+
+#endif /* STEADY_H */
@@ -0,0 +1,271 @@
+/**
+ * @file telemetry.cpp
+ * @author Javier Vela
+ * @brief Source file of the telemetry of the Genetic Algorithm, records of every node buffered and written by root
+ * @version 0.1
+ * @date 2022-01-03
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <iostream>
+#include "telemetry.h"
+
+using namespace std;
+
+/**
+ * @brief Fraction of the edges of TELEMETRY_SAMPLE individuals, spread over the order of the population, that are
+ * not in its fittest individual (0 when all of them are the same tour)
+ *
+ * @param population population, EXPECTED to be sorted
+ * @param best_pos scratch memory, position of every city in the fittest
+ */
+float population_diversity(Population &population, vector<int> &best_pos)
+{
+	int n = population.length;
+	if (population.size < 2 || n < 3)
+		return 0;
+
+	const gene_t *best = gnome(population, population.order[0]);
+	best_pos.resize(n + 1); // Cities are numbered from 1
+	for (int i = 0; i < n; i++)
+		best_pos[best[i]] = i;
+
+	int samples = min(TELEMETRY_SAMPLE, population.size - 1);
+	long long different = 0;
+	for (int s = 1; s <= samples; s++)
+	{
+		const gene_t *tour = gnome(population, population.order[(long long)s * (population.size - 1) / samples]);
+		for (int i = 0; i < n; i++)
+		{
+			int d = best_pos[tour[i]] - best_pos[tour[(i + 1) % n]];
+			if (d != 1 && d != -1 && d != n - 1 && d != 1 - n)
+				different++;
+		}
+	}
+	return (float)different / ((long long)samples * n);
+}
+
+/**
+ * @brief Write the records queued by root until the telemetry is finished (writer thread of root)
+ */
+static void write_records(Telemetry &telemetry)
+{
+	vector<TelemetryRecord> records;
+	while (true)
+	{
+		{
+			unique_lock<mutex> lock(telemetry.queue_mutex);
+			telemetry.queue_ready.wait(lock, [&] { return !telemetry.queue.empty() || telemetry.closing; });
+			if (telemetry.queue.empty())
+				break;
+			swap(records, telemetry.queue);
+		}
+
+		if (telemetry.binary)
+			telemetry.file.write((const char *)records.data(), records.size() * sizeof(TelemetryRecord));
+		else
+		{
+			for (const TelemetryRecord &r : records)
+				telemetry.file << r.rank << "," << r.generation << "," << r.time << "," << r.best << "," << r.mean << ","
+							   << r.diversity << "," << r.offspring_rate << "," << r.bytes << "\n";
+		}
+		records.clear();
+	}
+	telemetry.file.flush();
+}
+
+/**
+ * @brief Start the telemetry of a node, collective over all nodes. Nothing is recorded if <file_name> is empty.
+ *
+ * @param telemetry telemetry to initialize
+ * @param file_name where root writes the records of all nodes, as a binary stream if it ends in .bin, as CSV otherwise
+ * @param comm MPI nodes of the run
+ */
+void init_telemetry(Telemetry &telemetry, const string &file_name, MPI_Comm comm, int mpi_rank, int mpi_size, int mpi_root)
+{
+	telemetry.enabled = file_name != "";
+	if (!telemetry.enabled)
+		return;
+
+	telemetry.binary = file_name.size() >= 4 && file_name.compare(file_name.size() - 4, 4, ".bin") == 0;
+	telemetry.mpi_rank = mpi_rank;
+	telemetry.mpi_size = mpi_size;
+	telemetry.mpi_root = mpi_root;
+	MPI_Comm_dup(comm, &telemetry.comm);
+	telemetry.ring.resize(TELEMETRY_RING);
+	telemetry.head = telemetry.count = 0;
+	telemetry.dropped = 0;
+	telemetry.send_request = MPI_REQUEST_NULL;
+
+	if (mpi_rank != mpi_root)
+		return;
+
+	telemetry.file.open(file_name, telemetry.binary ? ios::out | ios::binary : ios::out);
+	if (!telemetry.file)
+	{
+		cout << "Error : telemetry file " << file_name << " can not be written" << endl;
+		MPI_Abort(MPI_COMM_WORLD, -1);
+	}
+
+	// The binary stream starts with its magic, version and record size
+	if (telemetry.binary)
+	{
+		uint32_t header[3] = {0x54505354 /* "TSPT" */, 1, sizeof(TelemetryRecord)};
+		telemetry.file.write((const char *)header, sizeof(header));
+	}
+	else
+		telemetry.file << "rank,generation,time_us,best,mean,diversity,offspring_per_second,bytes_sent\n";
+
+	telemetry.finished = 0;
+	telemetry.closing = false;
+	telemetry.writer = thread(write_records, ref(telemetry));
+}
+
+/**
+ * @brief Move the records of the ring, oldest first, to the end of <records>
+ */
+static void take_ring(Telemetry &telemetry, vector<TelemetryRecord> &records)
+{
+	for (int i = 0; i < telemetry.count; i++)
+		records.push_back(telemetry.ring[(telemetry.head + i) % TELEMETRY_RING]);
+	telemetry.head = telemetry.count = 0;
+}
+
+/**
+ * @brief Queue records for the writer of root
+ */
+static void queue_records(Telemetry &telemetry, const TelemetryRecord *records, int n)
+{
+	if (n == 0)
+		return;
+	{
+		lock_guard<mutex> lock(telemetry.queue_mutex);
+		telemetry.queue.insert(telemetry.queue.end(), records, records + n);
+	}
+	telemetry.queue_ready.notify_one();
+}
+
+/**
+ * @brief Queue the messages of other nodes that arrived (root), or wait for one of them if <wait>
+ */
+static void receive_records(Telemetry &telemetry, bool wait)
+{
+	while (true)
+	{
+		int arrived = 1;
+		MPI_Status status;
+		if (wait)
+			MPI_Probe(MPI_ANY_SOURCE, TELEMETRY_TAG, telemetry.comm, &status);
+		else
+			MPI_Iprobe(MPI_ANY_SOURCE, TELEMETRY_TAG, telemetry.comm, &arrived, &status);
+		if (!arrived)
+			return;
+
+		int bytes;
+		MPI_Get_count(&status, MPI_BYTE, &bytes);
+		telemetry.receive_buffer.resize(bytes / sizeof(TelemetryRecord));
+		MPI_Recv(telemetry.receive_buffer.data(), bytes, MPI_BYTE, status.MPI_SOURCE, TELEMETRY_TAG, telemetry.comm, MPI_STATUS_IGNORE);
+		if (bytes == 0)
+			telemetry.finished++;
+		queue_records(telemetry, telemetry.receive_buffer.data(), telemetry.receive_buffer.size());
+
+		if (wait)
+			return;
+	}
+}
+
+/**
+ * @brief Record the state of the population of the node. Never waits for other nodes or for the file.
+ *
+ * @param telemetry telemetry of the node
+ * @param generation last generation bred
+ * @param population population, EXPECTED to be sorted
+ * @param time microseconds since the algorithm started
+ * @param offspring_rate children per second in the last batch
+ * @param bytes bytes sent to other nodes since the start
+ */
+void record_telemetry(Telemetry &telemetry, int generation, Population &population, long long time, double offspring_rate, long long bytes)
+{
+	if (!telemetry.enabled)
+		return;
+
+	TelemetryRecord record;
+	record.rank = telemetry.mpi_rank;
+	record.generation = generation;
+	record.time = time;
+	record.best = population.fitness[population.order[0]];
+	double sum = 0;
+	for (int i = 0; i < population.size; i++)
+		sum += population.fitness[i];
+	record.mean = sum / max(1, population.size);
+	record.diversity = population_diversity(population, telemetry.best_pos);
+	record.offspring_rate = offspring_rate;
+	record.bytes = bytes;
+
+	if (telemetry.count == TELEMETRY_RING)
+	{
+		telemetry.head = (telemetry.head + 1) % TELEMETRY_RING;
+		telemetry.count--;
+		telemetry.dropped++;
+	}
+	telemetry.ring[(telemetry.head + telemetry.count) % TELEMETRY_RING] = record;
+	telemetry.count++;
+
+	if (telemetry.mpi_rank == telemetry.mpi_root)
+	{
+		vector<TelemetryRecord> records;
+		take_ring(telemetry, records);
+		queue_records(telemetry, records.data(), records.size());
+		receive_records(telemetry, false);
+		return;
+	}
+
+	// Records wait in the ring while the previous send is in flight
+	int done;
+	MPI_Test(&telemetry.send_request, &done, MPI_STATUS_IGNORE);
+	if (telemetry.count >= TELEMETRY_FLUSH && done)
+	{
+		telemetry.send_buffer.clear();
+		take_ring(telemetry, telemetry.send_buffer);
+		MPI_Isend(telemetry.send_buffer.data(), telemetry.send_buffer.size() * sizeof(TelemetryRecord), MPI_BYTE, telemetry.mpi_root, TELEMETRY_TAG, telemetry.comm, &telemetry.send_request);
+	}
+}
+
+/**
+ * @brief Send the records left to root, which writes all of them and closes the file. Collective over all nodes.
+ */
+void finish_telemetry(Telemetry &telemetry)
+{
+	if (!telemetry.enabled)
+		return;
+
+	if (telemetry.mpi_rank != telemetry.mpi_root)
+	{
+		MPI_Wait(&telemetry.send_request, MPI_STATUS_IGNORE);
+		telemetry.send_buffer.clear();
+		take_ring(telemetry, telemetry.send_buffer);
+		if (!telemetry.send_buffer.empty())
+			MPI_Send(telemetry.send_buffer.data(), telemetry.send_buffer.size() * sizeof(TelemetryRecord), MPI_BYTE, telemetry.mpi_root, TELEMETRY_TAG, telemetry.comm);
+		MPI_Send(NULL, 0, MPI_BYTE, telemetry.mpi_root, TELEMETRY_TAG, telemetry.comm);
+	}
+	else
+	{
+		while (telemetry.finished < telemetry.mpi_size - 1)
+			receive_records(telemetry, true);
+
+		{
+			lock_guard<mutex> lock(telemetry.queue_mutex);
+			telemetry.closing = true;
+		}
+		telemetry.queue_ready.notify_one();
+		telemetry.writer.join();
+		telemetry.file.close();
+	}
+
+	if (telemetry.dropped > 0)
+		cerr << "Warning : " << telemetry.dropped << " telemetry records of node " << telemetry.mpi_rank << " dropped" << endl;
+	MPI_Comm_free(&telemetry.comm);
+	telemetry.enabled = false;
+}
@@ -0,0 +1,89 @@
+/**
+ * @file telemetry.h
+ * @author Javier Vela
+ * @brief Header file of the telemetry of the Genetic Algorithm, records of every node buffered and written by root
+ * @version 0.1
+ * @date 2022-01-03
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "population.h"
+#include "mpi.h"
+
+/// Records kept by a node while its previous ones are still being sent, the oldest are dropped when it is full
+#ifndef TELEMETRY_RING
+#define TELEMETRY_RING 4096
+#endif
+
+/// Records a node gathers before sending them to root
+#ifndef TELEMETRY_FLUSH
+#define TELEMETRY_FLUSH 64
+#endif
+
+/// Individuals compared with the fittest to estimate the diversity of a population
+#ifndef TELEMETRY_SAMPLE
+#define TELEMETRY_SAMPLE 16
+#endif
+
+/// Tag of the messages with telemetry records
+#define TELEMETRY_TAG 2
+
+/// State of a node at a batch boundary (one CSV line, or 40 bytes of the binary stream)
+struct TelemetryRecord
+{
+	int32_t rank, generation;
+	int64_t time;         // Microseconds since the algorithm started
+	float best, mean;     // Fitness of the fittest and mean fitness of the population
+	float diversity;      // Fraction of the edges of sampled individuals not in the fittest
+	float offspring_rate; // Children per second in the last batch
+	int64_t bytes;        // Bytes sent to other nodes since the start
+};
+
+/**
+ * @brief Telemetry of a node
+ *
+ * Records are pushed into a ring and sent to root TELEMETRY_FLUSH at a time without waiting for the previous send.
+ * Root queues its records and the ones it receives for a writer thread, so neither the nodes nor root wait for the
+ * file.
+ */
+struct Telemetry
+{
+	bool enabled;
+	bool binary;                              // Binary stream (file ending in .bin) instead of CSV
+	int mpi_rank, mpi_size, mpi_root;
+	MPI_Comm comm;                            // Duplicate of the communicator of the run only used for telemetry
+	std::vector<TelemetryRecord> ring;
+	int head, count;                          // Oldest record of the ring and records in it
+	long long dropped;
+	std::vector<TelemetryRecord> send_buffer; // Records of the send in flight
+	MPI_Request send_request;
+	std::vector<int> best_pos;                // Position of every city in the fittest (diversity)
+	// Root only
+	std::vector<TelemetryRecord> receive_buffer;
+	int finished;                             // Nodes whose last message arrived (it is empty)
+	std::vector<TelemetryRecord> queue;       // Records waiting for the writer
+	std::mutex queue_mutex;
+	std::condition_variable queue_ready;
+	bool closing;
+	std::ofstream file;
+	std::thread writer;
+};
+
+float population_diversity(Population &population, std::vector<int> &best_pos);
+void init_telemetry(Telemetry &telemetry, const std::string &file_name, MPI_Comm comm, int mpi_rank, int mpi_size, int mpi_root);
+void record_telemetry(Telemetry &telemetry, int generation, Population &population, long long time, double offspring_rate, long long bytes);
+void finish_telemetry(Telemetry &telemetry);
+
+#endif /* TELEMETRY_H */
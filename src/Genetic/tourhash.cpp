@@ -0,0 +1,114 @@
+/**
+ * @file tourhash.cpp
+ * @author Javier Vela
+ * @brief Source file of the hashes of the tours and the fitness cache shared by the threads of the Genetic Algorithm
+ * @version 0.1
+ * @date 2022-01-08
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <cstring>
+#include "tourhash.h"
+
+using namespace std;
+
+/// Set in the data of every written slot, so an empty slot never matches
+#define CACHE_SLOT_USED (1ULL << 32)
+
+/// Seed of the keys of the cities, the same in every node and run
+#define TOUR_KEYS_SEED 0x5eed7ca5e5ULL
+
+/**
+ * @brief Draw the keys of the <V> cities of a problem, indexed by city (1 ... V)
+ *
+ * @param symmetric edges have the same key in both directions
+ */
+void init_tour_keys(TourKeys &keys, int V, bool symmetric)
+{
+	uint64_t state = TOUR_KEYS_SEED;
+	keys.from.resize(V + 1);
+	keys.to.resize(V + 1);
+	for (int c = 0; c <= V; c++)
+		keys.from[c] = splitmix64(state) | 1;
+	for (int c = 0; c <= V; c++)
+		keys.to[c] = symmetric ? keys.from[c] : splitmix64(state) | 1;
+}
+
+/**
+ * @brief Hash of the set of edges of a tour, the XOR of the keys of its edges (Zobrist hashing)
+ *
+ * Rotations of a tour, and reversals if the problem is symmetric, have the same hash. Swapping two cities changes up to
+ * four edges, so the hash of a mutated tour is updated with their keys (see mutate_gnome) instead of hashing it again.
+ *
+ * @param keys keys of the cities of the problem
+ * @param gnome tour
+ * @param V size of map (genes in the gnome)
+ */
+uint64_t tour_hash(const TourKeys &keys, const gene_t *gnome, int V)
+{
+	uint64_t hash = 0;
+	for (int i = 0; i < V; i++)
+		hash ^= edge_hash(keys, gnome[i], gnome[i + 1 == V ? 0 : i + 1]);
+	return hash;
+}
+
+/**
+ * @brief Hash individuals <first> ... <first> + <count> - 1 of a population into <hashes>
+ */
+void hash_population(const TourKeys &keys, Population &population, int first, int count, vector<uint64_t> &hashes)
+{
+	if (hashes.size() < (size_t)(first + count))
+		hashes.resize(first + count);
+
+#pragma omp parallel for schedule(static)
+	for (int i = first; i < first + count; i++)
+		hashes[i] = tour_hash(keys, gnome(population, i), population.length);
+}
+
+/**
+ * @brief Empty the cache and give it at least <size> slots
+ */
+void init_fitness_cache(FitnessCache &cache, size_t size)
+{
+	size_t slots = 2;
+	cache.shift = 63;
+	while (slots < size)
+		slots <<= 1, cache.shift--;
+	cache.slots.reset(new CacheSlot[slots]);
+	for (size_t s = 0; s < slots; s++)
+	{
+		cache.slots[s].check.store(0, memory_order_relaxed);
+		cache.slots[s].data.store(0, memory_order_relaxed);
+	}
+}
+
+/**
+ * @brief Fitness of the tour of <hash> if it is in the cache
+ *
+ * @return whether it was found
+ */
+bool cached_fitness(FitnessCache &cache, uint64_t hash, float &fitness)
+{
+	CacheSlot &slot = cache.slots[hash >> cache.shift];
+	uint64_t data = slot.data.load(memory_order_relaxed);
+	if (!(data & CACHE_SLOT_USED) || (slot.check.load(memory_order_relaxed) ^ data) != hash)
+		return false;
+	uint32_t bits = (uint32_t)data;
+	memcpy(&fitness, &bits, sizeof(float));
+	return true;
+}
+
+/**
+ * @brief Store the fitness of the tour of <hash>
+ */
+void cache_fitness(FitnessCache &cache, uint64_t hash, float fitness)
+{
+	CacheSlot &slot = cache.slots[hash >> cache.shift];
+	uint32_t bits;
+	memcpy(&bits, &fitness, sizeof(float));
+	uint64_t data = CACHE_SLOT_USED | bits;
+	slot.data.store(data, memory_order_relaxed);
+	slot.check.store(hash ^ data, memory_order_relaxed);
+}
@@ -0,0 +1,75 @@
+/**
+ * @file tourhash.h
+ * @author Javier Vela
+ * @brief Header file of the hashes of the tours and the fitness cache shared by the threads of the Genetic Algorithm
+ * @version 0.1
+ * @date 2022-01-08
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef TOURHASH_H
+#define TOURHASH_H
+
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "population.h"
+#include "random.h"
+
+/// Generations of children the fitness cache holds, roughly
+#ifndef FITNESS_CACHE_GENERATIONS
+#define FITNESS_CACHE_GENERATIONS 8
+#endif
+
+/**
+ * @brief Random keys of the cities, the key of an edge is the product of the keys of its ends
+ *
+ * Keys are odd, so no product is zero. The key of a city at the end of an edge is the one at its start if the problem is
+ * symmetric, so an edge has the same key in both directions.
+ */
+struct TourKeys
+{
+	std::vector<uint64_t> from, to;
+};
+
+/**
+ * @brief Key of the edge from city <a> to city <b>
+ */
+inline uint64_t edge_hash(const TourKeys &keys, gene_t a, gene_t b)
+{
+	return keys.from[a] * keys.to[b];
+}
+
+/**
+ * @brief Slot of the fitness cache, read and written without locks
+ *
+ * <check> is the hash of the tour XOR <data>, so a slot torn by two threads writing it at once does not match any tour.
+ */
+struct CacheSlot
+{
+	std::atomic<uint64_t> check, data;
+};
+
+/**
+ * @brief Fitness of the tours already evaluated, by tour hash, shared by all threads
+ *
+ * Direct-mapped, a tour takes the slot of its hash and replaces the one that was there.
+ */
+struct FitnessCache
+{
+	std::unique_ptr<CacheSlot[]> slots;
+	int shift; // 64 - log2 of the slots, a tour takes the slot of the high bits of its hash, the best mixed
+};
+
+void init_tour_keys(TourKeys &keys, int V, bool symmetric);
+uint64_t tour_hash(const TourKeys &keys, const gene_t *gnome, int V);
+void hash_population(const TourKeys &keys, Population &population, int first, int count, std::vector<uint64_t> &hashes);
+void init_fitness_cache(FitnessCache &cache, size_t size);
+bool cached_fitness(FitnessCache &cache, uint64_t hash, float &fitness);
+void cache_fitness(FitnessCache &cache, uint64_t hash, float fitness);
+
+#endif /* TOURHASH_H */
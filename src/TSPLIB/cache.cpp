@@ -0,0 +1,206 @@
+/**
+ * @file cache.cpp
+ * @author Javier Vela
+ * @brief Source file of the binary cache of preprocessed TSPLIB problems, memory-mapped at startup
+ * @version 0.1
+ * @date 2021-12-27
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "cache.h"
+#include "distance.h"
+
+using namespace std;
+
+static const char CACHE_MAGIC[8] = "TSPBIN";
+static const uint32_t CACHE_BYTE_ORDER = 0x01020304;
+
+/**
+ * @brief Place an array of <bytes> at the end of the cache
+ *
+ * @param end end of the cache, moved after the array
+ * @return offset of the array, 0 if it is empty
+ */
+static uint64_t placeArray(uint64_t &end, size_t bytes)
+{
+    if (bytes == 0)
+        return 0;
+    uint64_t offset = (end + CACHE_ALIGNMENT - 1) / CACHE_ALIGNMENT * CACHE_ALIGNMENT;
+    end = offset + bytes;
+    return offset;
+}
+
+static void writeArray(ofstream &out, uint64_t offset, const void *data, size_t bytes)
+{
+    if (offset == 0)
+        return;
+    static const char padding[CACHE_ALIGNMENT] = {0};
+    out.write(padding, offset - out.tellp());
+    out.write((const char *)data, bytes);
+}
+
+/**
+ * @brief Write the cache of a problem to <inputName>.tspbin
+ *
+ * The cache is written to a temporary file and renamed, so processes reading it never see a partial cache.
+ *
+ * @param inputName problem path without extension, <inputName>.tsp is the source of the cache
+ * @param tsp TSP problem, with its distances, neighbours and optimal cost
+ * @return false if the cache can not be written
+ */
+bool writeCache(const string &inputName, const Map &tsp)
+{
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+    header.version = CACHE_VERSION;
+    header.byteOrder = CACHE_BYTE_ORDER;
+
+    struct stat source;
+    if (stat((inputName + ".tsp").c_str(), &source) == 0)
+    {
+        header.sourceSize = source.st_size;
+        header.sourceTime = source.st_mtime;
+    }
+
+    strncpy(header.name, tsp.name.c_str(), sizeof(header.name) - 1);
+    header.dimension = tsp.dimension;
+    header.edgeWeightType = tsp.edgeWeightType;
+    header.edgeWeightFormat = tsp.edgeWeightFormat;
+    header.symmetric = tsp.symmetric;
+    header.matrixElement = tsp.matrixElement;
+    header.matrixLayout = tsp.matrixLayout;
+    header.neighbourK = tsp.neighbourK;
+    header.optimalCost = tsp.optimalCost;
+
+    size_t side = tsp.dimension + 1;
+    size_t coordinateBytes = tsp.x ? side * sizeof(double) : 0;
+    size_t matrixSize = tsp.backend == DENSE_MATRIX ? matrixBytes(tsp.matrixElement, tsp.matrixLayout, tsp.dimension) : 0;
+    size_t neighbourCount = side * tsp.neighbourK;
+
+    uint64_t end = sizeof(CacheHeader);
+    header.x = placeArray(end, coordinateBytes);
+    header.y = placeArray(end, coordinateBytes);
+    header.z = placeArray(end, tsp.z ? coordinateBytes : 0);
+    header.matrix = placeArray(end, matrixSize);
+    header.neighbours = placeArray(end, neighbourCount * sizeof(int));
+    header.neighbourDistance = placeArray(end, neighbourCount * sizeof(float));
+    header.fileSize = end;
+
+    string cacheName = inputName + CACHE_EXTENSION;
+    string temporaryName = cacheName + ".tmp";
+    ofstream out(temporaryName, ios::binary | ios::trunc);
+    if (!out)
+        return false;
+    out.write((const char *)&header, sizeof(header));
+    writeArray(out, header.x, tsp.x, coordinateBytes);
+    writeArray(out, header.y, tsp.y, coordinateBytes);
+    writeArray(out, header.z, tsp.z, coordinateBytes);
+    writeArray(out, header.matrix, tsp.matrix, matrixSize);
+    writeArray(out, header.neighbours, tsp.neighbours, neighbourCount * sizeof(int));
+    writeArray(out, header.neighbourDistance, tsp.neighbourDistance, neighbourCount * sizeof(float));
+    out.close();
+
+    if (!out || rename(temporaryName.c_str(), cacheName.c_str()) != 0)
+    {
+        remove(temporaryName.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Load a problem from its cache <inputName>.tspbin
+ *
+ * The cache is mapped read-only and shared, so every process of a node reads the same pages of the page cache and the
+ * arrays of the problem point into them. Only the spatial index is built again. A cache older than <inputName>.tsp,
+ * or of another version, is ignored with a warning.
+ *
+ * @param inputName problem path without extension
+ * @param tsp TSP problem where to load the cache, with its optimal cost
+ * @return false if there is no valid cache (tsp is untouched)
+ */
+bool readCache(const string &inputName, Map &tsp)
+{
+    string cacheName = inputName + CACHE_EXTENSION;
+    int fd = open(cacheName.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    void *mapping = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(CacheHeader))
+        mapping = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        cerr << "Warning : " << cacheName << " can not be mapped, parsing the problem" << endl;
+        return false;
+    }
+
+    const CacheHeader &header = *(const CacheHeader *)mapping;
+    struct stat source;
+    const char *reason = NULL;
+    if (memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) != 0 || header.byteOrder != CACHE_BYTE_ORDER)
+        reason = "is not a cache of this machine";
+    else if (header.version != CACHE_VERSION)
+        reason = "has another version";
+    else if (header.fileSize != (uint64_t)st.st_size)
+        reason = "is truncated";
+    else if (stat((inputName + ".tsp").c_str(), &source) == 0 &&
+             ((uint64_t)source.st_size != header.sourceSize || (int64_t)source.st_mtime != header.sourceTime))
+        reason = "is out of date";
+
+    if (reason)
+    {
+        cerr << "Warning : " << cacheName << " " << reason << ", parsing the problem" << endl;
+        munmap(mapping, st.st_size);
+        return false;
+    }
+
+    // Every page is used, read them ahead instead of faulting them one by one
+    madvise(mapping, st.st_size, MADV_WILLNEED);
+
+    const char *base = (const char *)mapping;
+    tsp.cache = mapping;
+    tsp.cacheSize = st.st_size;
+    tsp.name = string(header.name, strnlen(header.name, sizeof(header.name)));
+    tsp.dimension = header.dimension;
+    tsp.edgeWeightType = (EdgeWeightType)header.edgeWeightType;
+    tsp.edgeWeightFormat = (EdgeWeightFormat)header.edgeWeightFormat;
+    tsp.symmetric = header.symmetric;
+    tsp.optimalCost = header.optimalCost;
+    tsp.x = header.x ? (const double *)(base + header.x) : NULL;
+    tsp.y = header.y ? (const double *)(base + header.y) : NULL;
+    tsp.z = header.z ? (const double *)(base + header.z) : NULL;
+    tsp.matrix = header.matrix ? base + header.matrix : NULL;
+    tsp.matrixElement = (MatrixElement)header.matrixElement;
+    tsp.matrixLayout = (MatrixLayout)header.matrixLayout;
+    tsp.backend = tsp.matrix ? DENSE_MATRIX : LAZY_COORDINATES;
+    tsp.neighbourK = header.neighbourK;
+    tsp.neighbours = header.neighbours ? (const int *)(base + header.neighbours) : NULL;
+    tsp.neighbourDistance = header.neighbourDistance ? (const float *)(base + header.neighbourDistance) : NULL;
+
+    if (tsp.edgeWeightType != EXPLICIT)
+        buildSpatialIndex(tsp);
+
+    return true;
+}
+
+/**
+ * @brief Unmap the cache a problem was loaded from (its arrays are no longer valid)
+ */
+void closeCache(Map &tsp)
+{
+    if (tsp.cache)
+        munmap(tsp.cache, tsp.cacheSize);
+    tsp.cache = NULL;
+    tsp.cacheSize = 0;
+}
@@ -0,0 +1,61 @@
+/**
+ * @file cache.h
+ * @author Javier Vela
+ * @brief Header file of the binary cache of preprocessed TSPLIB problems, memory-mapped at startup
+ * @version 0.1
+ * @date 2021-12-27
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <cstdint>
+#include <string>
+#include "tsplib.h"
+
+/// Extension of the cache of <inputName>, written next to <inputName>.tsp
+#define CACHE_EXTENSION ".tspbin"
+
+/// Version of the cache layout, caches of other versions are ignored
+#define CACHE_VERSION 2
+
+/// Alignment of the arrays in the cache (a cache line)
+#define CACHE_ALIGNMENT 64
+
+/**
+ * @brief Header at the start of a cache, followed by the arrays of the problem at the offsets it gives
+ *
+ * The arrays have the same layout as in Map (index 0 unused, the matrix with its element and layout), so the problem
+ * reads them straight from the mapped file.
+ */
+struct CacheHeader
+{
+    char magic[8];             // "TSPBIN" padded with zeros
+    uint32_t version;          // CACHE_VERSION
+    uint32_t byteOrder;        // 0x01020304 as written by the host that prepared the cache
+    uint64_t fileSize;         // Size of the whole cache
+    uint64_t sourceSize;       // Size and modification time of the .tsp the cache was prepared from
+    int64_t sourceTime;
+    char name[64];
+    int32_t dimension;
+    int32_t edgeWeightType;
+    int32_t edgeWeightFormat;
+    int32_t symmetric;
+    int32_t matrixElement;
+    int32_t matrixLayout;
+    int32_t neighbourK;
+    float optimalCost;
+    uint64_t x, y, z;          // Offsets of the arrays in the cache, 0 if the problem has none
+    uint64_t matrix;
+    uint64_t neighbours;
+    uint64_t neighbourDistance;
+};
+
+bool writeCache(const std::string &inputName, const Map &tsp);
+bool readCache(const std::string &inputName, Map &tsp);
+void closeCache(Map &tsp);
+
+#endif /* CACHE_H */
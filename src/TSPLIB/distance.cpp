@@ -0,0 +1,247 @@
+/**
+ * @file distance.cpp
+ * @author Javier Vela
+ * @brief Source file of the distance engine of TSPLIB problems (dense matrix or lazy coordinates)
+ * @version 0.1
+ * @date 2021-12-10
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <algorithm>
+#include <cstring>
+#include "distance.h"
+
+using namespace std;
+
+/**
+ * @brief Fill the cells of a matrix, out of <weights> (full (dimension + 1)^2 matrix) or the coordinates if NULL
+ */
+template <typename Matrix>
+static void fillMatrix(Map &tsp, const float *weights)
+{
+    typedef typename Matrix::element_type T;
+    int n = tsp.dimension;
+    size_t side = n + 1;
+    T *data = (T *)tsp.matrixData.get();
+    if (Matrix::layout == MATRIX_FULL)
+        memset(data, 0, Matrix::cells(n) * sizeof(T));
+
+#pragma omp parallel for schedule(dynamic, 16)
+    for (int i = 1; i <= n; i++)
+    {
+        for (int j = Matrix::layout == MATRIX_PACKED ? i : 1; j <= n; j++)
+        {
+            data[Matrix::index(n, i, j)] = (T)(weights ? weights[i * side + j] : coordinateDistance(tsp, i, j));
+        }
+    }
+}
+
+/**
+ * @brief Allocate the matrix of the problem with its element and layout and fill it
+ */
+static void allocateAndFill(Map &tsp, const float *weights)
+{
+    tsp.matrixData = allocateMatrix(matrixBytes(tsp.matrixElement, tsp.matrixLayout, tsp.dimension));
+    tsp.matrix = tsp.matrixData.get();
+    withMatrix(tsp.matrixElement, tsp.matrixLayout, tsp.matrix, tsp.dimension, [&](auto matrix) {
+        fillMatrix<decltype(matrix)>(tsp, weights);
+    });
+}
+
+/**
+ * @brief Narrowest element that holds exactly every distance in [minimum, maximum], integer if <integral>
+ */
+static MatrixElement matrixElement(bool integral, double minimum, double maximum)
+{
+    if (integral && minimum >= 0 && maximum <= UINT16_MAX)
+        return MATRIX_UINT16;
+    if (integral && minimum >= INT32_MIN && maximum <= INT32_MAX)
+        return MATRIX_INT32;
+    return MATRIX_FLOAT;
+}
+
+/**
+ * @brief Layout of a matrix, the triangle of symmetric problems unless the full matrix fits in the cache
+ */
+static MatrixLayout matrixLayout(MatrixElement element, bool symmetric, int n)
+{
+    if (!symmetric || matrixBytes(element, MATRIX_FULL, n) <= DENSE_FULL_MAX_BYTES)
+        return MATRIX_FULL;
+    return MATRIX_PACKED;
+}
+
+/**
+ * @brief Store the weights of a problem without coordinates as its dense matrix
+ *
+ * The element is the narrowest one that holds every weight and big symmetric problems only keep a triangle.
+ *
+ * @param tsp TSP problem object with dimension and symmetric flag
+ * @param weights full (dimension + 1)^2 row-major matrix of weights
+ */
+void storeMatrix(Map &tsp, const vector<float> &weights)
+{
+    size_t side = tsp.dimension + 1;
+    bool integral = true;
+    double minimum = 0, maximum = 0;
+    for (int i = 1; i <= tsp.dimension; i++)
+    {
+        for (int j = 1; j <= tsp.dimension; j++)
+        {
+            float w = weights[i * side + j];
+            integral &= w == floorf(w);
+            minimum = min(minimum, (double)w);
+            maximum = max(maximum, (double)w);
+        }
+    }
+
+    tsp.backend = DENSE_MATRIX;
+    tsp.matrixElement = matrixElement(integral, minimum, maximum);
+    tsp.matrixLayout = matrixLayout(tsp.matrixElement, tsp.symmetric, tsp.dimension);
+    allocateAndFill(tsp, weights.data());
+}
+
+/**
+ * @brief Select the distance backend of the problem and precompute the dense matrix if it is the cheapest option
+ *
+ * Problems without coordinates (EXPLICIT) always use the dense matrix stored by the reader. Otherwise the matrix is only built while it
+ * stays small enough to be faster than computing the distance again (cache sized for cheap distances, memory sized
+ * for expensive ones), so the memory of big problems is O(dimension) instead of O(dimension^2).
+ *
+ * Every TSPLIB distance out of coordinates is an integer, bounded by the manhattan extent of the cities (and by half
+ * the circumference of the earth for GEO), so most matrices take 16-bit cells. Distances out of coordinates are
+ * symmetric, only a triangle is kept once the full matrix outgrows the cache.
+ *
+ * @param tsp TSP problem object with dimension, edge weight type and coordinates
+ */
+void buildDistances(Map &tsp)
+{
+    tsp.neighbourK = 0;
+
+    // The reader already stored the matrix of problems without coordinates
+    if (tsp.edgeWeightType == EXPLICIT)
+        return;
+
+    buildSpatialIndex(tsp);
+
+    double extent = 0;
+    for (const double *c : {tsp.x, tsp.y, tsp.z})
+    {
+        if (c)
+            extent += *max_element(c + 1, c + tsp.dimension + 1) - *min_element(c + 1, c + tsp.dimension + 1);
+    }
+    double maximum = tsp.edgeWeightType == GEO ? 20040 : extent + 1;
+
+    tsp.matrixElement = matrixElement(true, 0, maximum);
+    tsp.matrixLayout = matrixLayout(tsp.matrixElement, true, tsp.dimension);
+    size_t bytes = matrixBytes(tsp.matrixElement, tsp.matrixLayout, tsp.dimension);
+    size_t limit = tsp.edgeWeightType == GEO ? DENSE_EXPENSIVE_MAX_BYTES : DENSE_CHEAP_MAX_BYTES;
+
+    if (bytes > limit)
+    {
+        tsp.backend = LAZY_COORDINATES;
+        tsp.matrixData.reset();
+        tsp.matrix = NULL;
+
+        if (tsp.edgeWeightType == GEO)
+            buildNeighbourCache(tsp, GEO_NEIGHBOUR_CACHE_K);
+        return;
+    }
+
+    tsp.backend = DENSE_MATRIX;
+    allocateAndFill(tsp, NULL);
+}
+
+/**
+ * @brief Build the k-d tree over the coordinates of the problem
+ *
+ * MAX and MAN distances are indexed with euclidean distances, so their nearest neighbours are approximate. GEO
+ * cities are indexed as points on the unit sphere, where the euclidean (chord) distance grows with the great
+ * circle distance, so nearest neighbour queries agree with the GEO distance.
+ *
+ * @param tsp TSP problem object with coordinates
+ */
+void buildSpatialIndex(Map &tsp)
+{
+    if (tsp.z != NULL)
+    {
+        buildKdTree(tsp.index, {tsp.x, tsp.y, tsp.z}, tsp.dimension);
+        return;
+    }
+    if (tsp.edgeWeightType != GEO)
+    {
+        buildKdTree(tsp.index, {tsp.x, tsp.y}, tsp.dimension);
+        return;
+    }
+
+    vector<double> sx(tsp.dimension + 1), sy(tsp.dimension + 1), sz(tsp.dimension + 1);
+    for (int i = 1; i <= tsp.dimension; i++)
+    {
+        sx[i] = cos(tsp.x[i]) * cos(tsp.y[i]);
+        sy[i] = cos(tsp.x[i]) * sin(tsp.y[i]);
+        sz[i] = sin(tsp.x[i]);
+    }
+    buildKdTree(tsp.index, {sx.data(), sy.data(), sz.data()}, tsp.dimension);
+}
+
+/**
+ * @brief Cache the <k> nearest neighbours of every city and their distances
+ *
+ * Problems with a spatial index answer a k-d tree query per city (O(n log n) in total), the rest compare every pair
+ * of cities.
+ *
+ * @param tsp TSP problem object
+ * @param k number of neighbours per city
+ */
+void buildNeighbourCache(Map &tsp, int k)
+{
+    k = min(k, tsp.dimension - 1);
+    tsp.neighbourK = 0;
+    if (k <= 0)
+        return;
+
+    tsp.neighboursData.assign((size_t)(tsp.dimension + 1) * k, 0);
+    tsp.neighbourDistanceData.assign((size_t)(tsp.dimension + 1) * k, 0.0);
+    bool indexed = tsp.index.n == tsp.dimension;
+
+#pragma omp parallel
+    {
+        vector<pair<float, int>> candidates(indexed ? k : tsp.dimension - 1);
+        vector<int> cities(k);
+        vector<double> distances2(k);
+
+#pragma omp for schedule(dynamic, 16)
+        for (int i = 1; i <= tsp.dimension; i++)
+        {
+            int c = 0;
+            if (indexed)
+            {
+                int found = kNearest(tsp.index, indexPoint(tsp, i), k, i, cities.data(), distances2.data());
+                for (int n = 0; n < found; n++)
+                    candidates[c++] = make_pair(getDistance(tsp, i, cities[n]), cities[n]);
+                // Rounded distances may tie differently than the index
+                sort(candidates.begin(), candidates.begin() + c);
+            }
+            else
+            {
+                for (int j = 1; j <= tsp.dimension; j++)
+                {
+                    if (j != i)
+                        candidates[c++] = make_pair(getDistance(tsp, i, j), j);
+                }
+                partial_sort(candidates.begin(), candidates.begin() + k, candidates.end());
+            }
+
+            for (int n = 0; n < k; n++)
+            {
+                tsp.neighboursData[(size_t)i * k + n] = candidates[n].second;
+                tsp.neighbourDistanceData[(size_t)i * k + n] = candidates[n].first;
+            }
+        }
+    }
+
+    tsp.neighbours = tsp.neighboursData.data();
+    tsp.neighbourDistance = tsp.neighbourDistanceData.data();
+    tsp.neighbourK = k;
+}
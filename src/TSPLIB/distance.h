@@ -0,0 +1,228 @@
+/**
+ * @file distance.h
+ * @author Javier Vela
+ * @brief Header file of the distance engine of TSPLIB problems (dense matrix or lazy coordinates)
+ * @version 0.1
+ * @date 2021-12-10
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef DISTANCE_H
+#define DISTANCE_H
+
+#include <cmath>
+#include <algorithm>
+#include "tsplib.h"
+
+/// Maximum size in bytes of a dense matrix for distances cheap to compute (EUC_2D, CEIL_2D, ATT), roughly a last level cache
+#ifndef DENSE_CHEAP_MAX_BYTES
+#define DENSE_CHEAP_MAX_BYTES (32UL << 20)
+#endif
+
+/// Maximum size in bytes of a dense matrix for distances expensive to compute (GEO)
+#ifndef DENSE_EXPENSIVE_MAX_BYTES
+#define DENSE_EXPENSIVE_MAX_BYTES (512UL << 20)
+#endif
+
+/// Maximum size in bytes of a dense matrix of a symmetric problem stored full, roughly a L2 cache (bigger ones only store
+/// a triangle, half the memory for one more multiplication per distance)
+#ifndef DENSE_FULL_MAX_BYTES
+#define DENSE_FULL_MAX_BYTES (256UL << 10)
+#endif
+
+/// Number of nearest neighbours cached per city when GEO distances are computed lazily
+#ifndef GEO_NEIGHBOUR_CACHE_K
+#define GEO_NEIGHBOUR_CACHE_K 8
+#endif
+
+/**
+ * @brief TSPLIB EUC_2D distance, euclidean distance rounded to the nearest integer
+ */
+inline float euc2dDistance(double xi, double yi, double xj, double yj)
+{
+    double xd = xi - xj, yd = yi - yj;
+    return (int)(sqrt(xd * xd + yd * yd) + 0.5);
+}
+
+/**
+ * @brief TSPLIB EUC_3D distance, euclidean distance in 3D rounded to the nearest integer
+ */
+inline float euc3dDistance(double xi, double yi, double zi, double xj, double yj, double zj)
+{
+    double xd = xi - xj, yd = yi - yj, zd = zi - zj;
+    return (int)(sqrt(xd * xd + yd * yd + zd * zd) + 0.5);
+}
+
+/**
+ * @brief TSPLIB MAX_2D / MAX_3D distance, maximum of the rounded distances along each axis (zd is 0 in 2D)
+ */
+inline float maxDistance(double xd, double yd, double zd)
+{
+    return std::max((int)(fabs(xd) + 0.5), std::max((int)(fabs(yd) + 0.5), (int)(fabs(zd) + 0.5)));
+}
+
+/**
+ * @brief TSPLIB MAN_2D / MAN_3D distance, manhattan distance rounded to the nearest integer (zd is 0 in 2D)
+ */
+inline float manDistance(double xd, double yd, double zd)
+{
+    return (int)(fabs(xd) + fabs(yd) + fabs(zd) + 0.5);
+}
+
+/**
+ * @brief TSPLIB CEIL_2D distance, euclidean distance rounded up
+ */
+inline float ceil2dDistance(double xi, double yi, double xj, double yj)
+{
+    double xd = xi - xj, yd = yi - yj;
+    return ceil(sqrt(xd * xd + yd * yd));
+}
+
+/**
+ * @brief TSPLIB ATT distance, pseudo-euclidean distance
+ */
+inline float attDistance(double xi, double yi, double xj, double yj)
+{
+    double xd = xi - xj, yd = yi - yj;
+    double rij = sqrt((xd * xd + yd * yd) / 10.0);
+    int tij = (int)(rij + 0.5);
+    return tij < rij ? tij + 1 : tij;
+}
+
+/**
+ * @brief TSPLIB GEO distance, geographical distance over the idealized earth
+ *
+ * @param lati latitude of the first city in radians
+ * @param loni longitude of the first city in radians
+ * @param latj latitude of the second city in radians
+ * @param lonj longitude of the second city in radians
+ */
+inline float geoDistance(double lati, double loni, double latj, double lonj)
+{
+    const double RRR = 6378.388;
+    double q1 = cos(loni - lonj);
+    double q2 = cos(lati - latj);
+    double q3 = cos(lati + latj);
+    return (int)(RRR * acos(0.5 * ((1.0 + q1) * q2 - (1.0 - q1) * q3)) + 1.0);
+}
+
+/**
+ * @brief Convert a TSPLIB GEO coordinate (DDD.MM degrees and minutes) into radians
+ *
+ * @param coordinate GEO coordinate as it is written in the problem file
+ * @return coordinate in radians
+ */
+inline double geoRadians(double coordinate)
+{
+    const double PI = 3.141592;
+    int deg = (int)coordinate;
+    double min = coordinate - deg;
+    return PI * (deg + 5.0 * min / 3.0) / 180.0;
+}
+
+/**
+ * @brief Compute the distance between two cities out of their coordinates
+ *
+ * @param tsp TSP problem object with coordinates
+ * @param i first city
+ * @param j second city
+ * @return distance between i and j
+ */
+inline float coordinateDistance(const Map &tsp, int i, int j)
+{
+    switch (tsp.edgeWeightType)
+    {
+    case EUC_3D:
+        return euc3dDistance(tsp.x[i], tsp.y[i], tsp.z[i], tsp.x[j], tsp.y[j], tsp.z[j]);
+    case MAX_2D:
+        return maxDistance(tsp.x[i] - tsp.x[j], tsp.y[i] - tsp.y[j], 0);
+    case MAX_3D:
+        return maxDistance(tsp.x[i] - tsp.x[j], tsp.y[i] - tsp.y[j], tsp.z[i] - tsp.z[j]);
+    case MAN_2D:
+        return manDistance(tsp.x[i] - tsp.x[j], tsp.y[i] - tsp.y[j], 0);
+    case MAN_3D:
+        return manDistance(tsp.x[i] - tsp.x[j], tsp.y[i] - tsp.y[j], tsp.z[i] - tsp.z[j]);
+    case CEIL_2D:
+        return ceil2dDistance(tsp.x[i], tsp.y[i], tsp.x[j], tsp.y[j]);
+    case ATT:
+        return attDistance(tsp.x[i], tsp.y[i], tsp.x[j], tsp.y[j]);
+    case GEO:
+        if (i == j)
+            return 0;
+        return geoDistance(tsp.x[i], tsp.y[i], tsp.x[j], tsp.y[j]);
+    default:
+        return euc2dDistance(tsp.x[i], tsp.y[i], tsp.x[j], tsp.y[j]);
+    }
+}
+
+/**
+ * @brief Distance between two cities with the backend selected for the problem
+ *
+ * @param tsp TSP problem object
+ * @param i first city
+ * @param j second city
+ * @return distance between i and j
+ */
+inline float getDistance(const Map &tsp, int i, int j)
+{
+    if (tsp.backend == DENSE_MATRIX)
+        return withMatrix(tsp.matrixElement, tsp.matrixLayout, tsp.matrix, tsp.dimension,
+                          [i, j](auto matrix) { return matrix(i, j); });
+
+    // Trigonometry is expensive, most edges of good tours join near neighbours
+    if (tsp.edgeWeightType == GEO && tsp.neighbourK > 0)
+    {
+        const int *n = &tsp.neighbours[(size_t)i * tsp.neighbourK];
+        for (int k = 0; k < tsp.neighbourK; k++)
+            if (n[k] == j)
+                return tsp.neighbourDistance[(size_t)i * tsp.neighbourK + k];
+    }
+
+    return coordinateDistance(tsp, i, j);
+}
+
+/// Distances of a problem without dense matrix, computed by getDistance
+struct LazyDistances
+{
+    const Map &tsp;
+
+    LazyDistances(const Map &tsp) : tsp(tsp) {}
+
+    inline float operator()(int i, int j) const
+    {
+        return getDistance(tsp, i, j);
+    }
+};
+
+/**
+ * @brief Call <f> with the distances of the problem, a DistanceMatrix view specialised for the element and layout of
+ * the dense matrix or LazyDistances
+ *
+ * Code templated on the distances (the hot loops of the Genetic Algorithm) is compiled once for every storage and
+ * selects it once per call instead of once per distance.
+ */
+template <typename F>
+inline void withDistances(const Map &tsp, F &&f)
+{
+    if (tsp.backend == DENSE_MATRIX)
+        withMatrix(tsp.matrixElement, tsp.matrixLayout, tsp.matrix, tsp.dimension, f);
+    else
+        f(LazyDistances(tsp));
+}
+
+/**
+ * @brief Point of a city in the space of the spatial index of the problem
+ */
+inline const double *indexPoint(const Map &tsp, int city)
+{
+    return &tsp.index.point[(size_t)tsp.index.slot[city] * tsp.index.dim];
+}
+
+void buildDistances(Map &tsp);
+void storeMatrix(Map &tsp, const std::vector<float> &weights);
+void buildSpatialIndex(Map &tsp);
+void buildNeighbourCache(Map &tsp, int k);
+
+#endif /* DISTANCE_H */
@@ -0,0 +1,333 @@
+/**
+ * @file kdtree.cpp
+ * @author Javier Vela
+ * @brief Source file of the k-d tree spatial index over the cities of a problem
+ * @version 0.1
+ * @date 2021-12-18
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <algorithm>
+#include <cfloat>
+#include "kdtree.h"
+
+using namespace std;
+
+/// Ranges bigger than this are built in a separate OpenMP task
+#define KDTREE_TASK_SIZE 4096
+
+/**
+ * @brief Build the subtree of slots [lo, hi), partitioning tree.city around the median of the widest dimension
+ */
+static void buildRange(KdTree &tree, const vector<const double *> &coordinates, int lo, int hi)
+{
+    if (hi - lo <= KDTREE_LEAF_SIZE)
+        return;
+
+    // Split on the dimension with the biggest spread
+    int best_d = 0;
+    double best_spread = -1;
+    for (int d = 0; d < tree.dim; d++)
+    {
+        const double *c = coordinates[d];
+        double min_c = DBL_MAX, max_c = -DBL_MAX;
+        for (int i = lo; i < hi; i++)
+        {
+            min_c = min(min_c, c[tree.city[i]]);
+            max_c = max(max_c, c[tree.city[i]]);
+        }
+        if (max_c - min_c > best_spread)
+        {
+            best_spread = max_c - min_c;
+            best_d = d;
+        }
+    }
+
+    int mid = (lo + hi) / 2;
+    const double *c = coordinates[best_d];
+    nth_element(tree.city.begin() + lo, tree.city.begin() + mid, tree.city.begin() + hi, [c](int a, int b)
+                { return c[a] < c[b]; });
+    tree.split[mid] = best_d;
+
+    if (hi - lo > KDTREE_TASK_SIZE)
+    {
+#pragma omp task shared(tree, coordinates)
+        buildRange(tree, coordinates, lo, mid);
+#pragma omp task shared(tree, coordinates)
+        buildRange(tree, coordinates, mid + 1, hi);
+#pragma omp taskwait
+    }
+    else
+    {
+        buildRange(tree, coordinates, lo, mid);
+        buildRange(tree, coordinates, mid + 1, hi);
+    }
+}
+
+/**
+ * @brief Build a k-d tree over cities 1..n, subtrees are built in parallel by OpenMP tasks
+ *
+ * @param tree tree to build
+ * @param coordinates one array per dimension with the coordinate of city i at position i
+ * @param n number of cities
+ */
+void buildKdTree(KdTree &tree, const vector<const double *> &coordinates, int n)
+{
+    tree.n = n;
+    tree.dim = coordinates.size();
+    tree.city.resize(n);
+    tree.slot.assign(n + 1, -1);
+    tree.split.assign(n, -1);
+    for (int i = 0; i < n; i++)
+        tree.city[i] = i + 1;
+
+#pragma omp parallel
+#pragma omp single
+    buildRange(tree, coordinates, 0, n);
+
+    tree.point.resize((size_t)n * tree.dim);
+#pragma omp parallel for
+    for (int i = 0; i < n; i++)
+    {
+        tree.slot[tree.city[i]] = i;
+        for (int d = 0; d < tree.dim; d++)
+            tree.point[(size_t)i * tree.dim + d] = coordinates[d][tree.city[i]];
+    }
+}
+
+static inline double distance2(const KdTree &tree, int slot, const double *q)
+{
+    const double *p = &tree.point[(size_t)slot * tree.dim];
+    double d2 = 0;
+    for (int d = 0; d < tree.dim; d++)
+        d2 += (p[d] - q[d]) * (p[d] - q[d]);
+    return d2;
+}
+
+/// State of a k nearest neighbours query, best points kept sorted by distance
+struct KnnQuery
+{
+    const double *q;
+    int k, exclude, found;
+    int *cities;
+    double *distances2;
+};
+
+static inline void offer(const KdTree &tree, KnnQuery &query, int slot)
+{
+    int city = tree.city[slot];
+    if (city == query.exclude)
+        return;
+
+    double d2 = distance2(tree, slot, query.q);
+    if (query.found == query.k && d2 >= query.distances2[query.k - 1])
+        return;
+
+    int i = query.found < query.k ? query.found++ : query.k - 1;
+    while (i > 0 && query.distances2[i - 1] > d2)
+    {
+        query.distances2[i] = query.distances2[i - 1];
+        query.cities[i] = query.cities[i - 1];
+        i--;
+    }
+    query.distances2[i] = d2;
+    query.cities[i] = city;
+}
+
+static void knnRange(const KdTree &tree, KnnQuery &query, int lo, int hi)
+{
+    if (hi - lo <= KDTREE_LEAF_SIZE)
+    {
+        for (int i = lo; i < hi; i++)
+            offer(tree, query, i);
+        return;
+    }
+
+    int mid = (lo + hi) / 2;
+    int d = tree.split[mid];
+    double diff = query.q[d] - tree.point[(size_t)mid * tree.dim + d];
+
+    offer(tree, query, mid);
+    if (diff < 0)
+    {
+        knnRange(tree, query, lo, mid);
+        if (query.found < query.k || diff * diff < query.distances2[query.k - 1])
+            knnRange(tree, query, mid + 1, hi);
+    }
+    else
+    {
+        knnRange(tree, query, mid + 1, hi);
+        if (query.found < query.k || diff * diff < query.distances2[query.k - 1])
+            knnRange(tree, query, lo, mid);
+    }
+}
+
+/**
+ * @brief Find the k points nearest to a query point in O(log n)
+ *
+ * @param tree k-d tree
+ * @param q query point
+ * @param k number of neighbours
+ * @param exclude city not to return (the query city itself), 0 for none
+ * @param cities where to write the neighbours, nearest first
+ * @param distances2 where to write the squared distances of the neighbours
+ * @return number of neighbours found (less than k only if the tree has fewer points)
+ */
+int kNearest(const KdTree &tree, const double *q, int k, int exclude, int *cities, double *distances2)
+{
+    KnnQuery query = {q, k, exclude, 0, cities, distances2};
+    if (k > 0)
+        knnRange(tree, query, 0, tree.n);
+    return query.found;
+}
+
+static void radiusRange(const KdTree &tree, const double *q, double radius2, int lo, int hi, vector<int> &cities)
+{
+    if (hi - lo <= KDTREE_LEAF_SIZE)
+    {
+        for (int i = lo; i < hi; i++)
+            if (distance2(tree, i, q) <= radius2)
+                cities.push_back(tree.city[i]);
+        return;
+    }
+
+    int mid = (lo + hi) / 2;
+    int d = tree.split[mid];
+    double diff = q[d] - tree.point[(size_t)mid * tree.dim + d];
+
+    if (distance2(tree, mid, q) <= radius2)
+        cities.push_back(tree.city[mid]);
+    if (diff <= 0 || diff * diff <= radius2)
+        radiusRange(tree, q, radius2, lo, mid, cities);
+    if (diff >= 0 || diff * diff <= radius2)
+        radiusRange(tree, q, radius2, mid + 1, hi, cities);
+}
+
+/**
+ * @brief Find all points within <radius> of a query point
+ *
+ * @param tree k-d tree
+ * @param q query point
+ * @param radius radius of the search (euclidean in the space of the tree)
+ * @param cities where to append the cities found
+ */
+void radiusSearch(const KdTree &tree, const double *q, double radius, vector<int> &cities)
+{
+    radiusRange(tree, q, radius * radius, 0, tree.n, cities);
+}
+
+static int initCount(const KdTree &tree, KdTreeMask &mask, int lo, int hi)
+{
+    if (hi - lo <= KDTREE_LEAF_SIZE)
+    {
+        if (hi > lo)
+            mask.count[lo] = hi - lo;
+        return hi - lo;
+    }
+
+    int mid = (lo + hi) / 2;
+    mask.count[mid] = 1 + initCount(tree, mask, lo, mid) + initCount(tree, mask, mid + 1, hi);
+    return mask.count[mid];
+}
+
+/**
+ * @brief Reset a mask so every point of the tree is present
+ */
+void initKdTreeMask(const KdTree &tree, KdTreeMask &mask)
+{
+    mask.removed.assign(tree.n, 0);
+    mask.count.assign(tree.n, 0);
+    initCount(tree, mask, 0, tree.n);
+}
+
+/**
+ * @brief Remove a city from the queries done with <mask> in O(log n)
+ */
+void removeKdTreeCity(const KdTree &tree, KdTreeMask &mask, int city)
+{
+    int s = tree.slot[city];
+    if (mask.removed[s])
+        return;
+    mask.removed[s] = 1;
+
+    int lo = 0, hi = tree.n;
+    while (hi - lo > KDTREE_LEAF_SIZE)
+    {
+        int mid = (lo + hi) / 2;
+        mask.count[mid]--;
+        if (s == mid)
+            return;
+        if (s < mid)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    mask.count[lo]--;
+}
+
+static void nearestRange(const KdTree &tree, const KdTreeMask &mask, const double *q, int lo, int hi, int &best, double &best_d2)
+{
+    if (hi <= lo)
+        return;
+    if (hi - lo <= KDTREE_LEAF_SIZE)
+    {
+        if (mask.count[lo] == 0)
+            return;
+        for (int i = lo; i < hi; i++)
+        {
+            if (mask.removed[i])
+                continue;
+            double d2 = distance2(tree, i, q);
+            if (d2 < best_d2)
+            {
+                best_d2 = d2;
+                best = i;
+            }
+        }
+        return;
+    }
+
+    int mid = (lo + hi) / 2;
+    if (mask.count[mid] == 0)
+        return;
+
+    if (!mask.removed[mid])
+    {
+        double d2 = distance2(tree, mid, q);
+        if (d2 < best_d2)
+        {
+            best_d2 = d2;
+            best = mid;
+        }
+    }
+
+    int d = tree.split[mid];
+    double diff = q[d] - tree.point[(size_t)mid * tree.dim + d];
+    if (diff < 0)
+    {
+        nearestRange(tree, mask, q, lo, mid, best, best_d2);
+        if (diff * diff < best_d2)
+            nearestRange(tree, mask, q, mid + 1, hi, best, best_d2);
+    }
+    else
+    {
+        nearestRange(tree, mask, q, mid + 1, hi, best, best_d2);
+        if (diff * diff < best_d2)
+            nearestRange(tree, mask, q, lo, mid, best, best_d2);
+    }
+}
+
+/**
+ * @brief Find the point nearest to a query point among the ones not removed from <mask>
+ *
+ * @return nearest remaining city, 0 if every city has been removed
+ */
+int nearestRemaining(const KdTree &tree, const KdTreeMask &mask, const double *q)
+{
+    int best = -1;
+    double best_d2 = DBL_MAX;
+    nearestRange(tree, mask, q, 0, tree.n, best, best_d2);
+    return best < 0 ? 0 : tree.city[best];
+}
@@ -0,0 +1,55 @@
+/**
+ * @file kdtree.h
+ * @author Javier Vela
+ * @brief Header file of the k-d tree spatial index over the cities of a problem
+ * @version 0.1
+ * @date 2021-12-18
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef KDTREE_H
+#define KDTREE_H
+
+#include <vector>
+
+/// Maximum number of points in a leaf of the tree
+#define KDTREE_LEAF_SIZE 8
+
+/// Maximum number of dimensions of the indexed points
+#define KDTREE_MAX_DIM 3
+
+/**
+ * @brief Balanced k-d tree stored implicitly in arrays
+ *
+ * A node covers a range [lo, hi) of slots: internal nodes split it at the median slot mid = (lo + hi) / 2, whose point
+ * is the node point, and continue on [lo, mid) and [mid + 1, hi). Ranges of up to KDTREE_LEAF_SIZE slots are leaves.
+ */
+struct KdTree
+{
+    int n;                     // Number of points
+    int dim;                   // Dimensions of the points
+    std::vector<int> city;     // City of the point in each slot
+    std::vector<int> slot;     // Slot of each city (inverse of city)
+    std::vector<double> point; // Coordinates of the point in slot i at [i * dim, (i + 1) * dim)
+    std::vector<signed char> split; // Split dimension of the internal node whose median is slot i
+
+    KdTree() : n(0), dim(0) {}
+};
+
+/// Points removed from a k-d tree, so queries only return the remaining ones (one per thread, the tree is shared)
+struct KdTreeMask
+{
+    std::vector<char> removed; // Removed flag of each slot
+    std::vector<int> count;    // Remaining points of the node whose median (internal) or first slot (leaf) is slot i
+};
+
+void buildKdTree(KdTree &tree, const std::vector<const double *> &coordinates, int n);
+int kNearest(const KdTree &tree, const double *q, int k, int exclude, int *cities, double *distances2);
+void radiusSearch(const KdTree &tree, const double *q, double radius, std::vector<int> &cities);
+void initKdTreeMask(const KdTree &tree, KdTreeMask &mask);
+void removeKdTreeCity(const KdTree &tree, KdTreeMask &mask, int city);
+int nearestRemaining(const KdTree &tree, const KdTreeMask &mask, const double *q);
+
+#endif /* KDTREE_H */
@@ -0,0 +1,136 @@
+/**
+ * @file matrix.h
+ * @author Javier Vela
+ * @brief Header file of the compact dense distance matrix, specialised at compile time for its element and layout
+ * @version 0.1
+ * @date 2021-12-28
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <algorithm>
+
+/// Alignment in bytes of the matrix allocation
+#define MATRIX_ALIGNMENT 64
+
+/// Type of the distances stored in a matrix, the narrowest that holds every distance exactly
+enum MatrixElement
+{
+    MATRIX_UINT16, // Integer distances up to 65535 (every TSPLIB problem with coordinates of moderate extent)
+    MATRIX_INT32,  // Other integer distances
+    MATRIX_FLOAT   // Distances with decimals
+};
+
+/// Cells of a matrix that are stored
+enum MatrixLayout
+{
+    MATRIX_FULL,  // (dimension + 1)^2 cells, row-major, row and column 0 unused
+    MATRIX_PACKED // Lower triangle with the diagonal, row-major, (dimension + 1) * (dimension + 2) / 2 cells, only for
+                  // symmetric problems
+};
+
+/**
+ * @brief Read-only view of a dense matrix of <T> distances with layout <L>
+ *
+ * Cities are numbered from 1. Code templated on the view compiles to a single load per distance, without any test of
+ * the element or the layout.
+ */
+template <typename T, MatrixLayout L>
+struct DistanceMatrix
+{
+    typedef T element_type;
+    static const MatrixLayout layout = L;
+
+    const T *data;
+    int n;
+
+    DistanceMatrix(const void *data, int n) : data((const T *)data), n(n) {}
+
+    /**
+     * @brief Cells of the matrix of a problem of <n> cities
+     */
+    static size_t cells(int n)
+    {
+        return L == MATRIX_FULL ? (size_t)(n + 1) * (n + 1) : (size_t)(n + 1) * (n + 2) / 2;
+    }
+
+    /**
+     * @brief Cell of the distance between cities <i> and <j>
+     */
+    static inline size_t index(int n, int i, int j)
+    {
+        if (L == MATRIX_FULL)
+            return (size_t)i * (n + 1) + j;
+        // Row r of the triangle starts after the 1 + 2 + ... + r cells of the previous rows. The order of the cities is
+        // random in the hot loops, so r and c are selected without branches
+        int d = (i - j) & ((i - j) >> 31);
+        size_t r = i - d, c = j + d;
+        return r * (r + 1) / 2 + c;
+    }
+
+    inline float operator()(int i, int j) const
+    {
+        return data[index(n, i, j)];
+    }
+};
+
+/**
+ * @brief Call <f> with the view of a matrix, specialised for its element and layout
+ */
+template <typename F>
+inline auto withMatrix(MatrixElement element, MatrixLayout layout, const void *data, int n, F &&f)
+{
+    if (layout == MATRIX_PACKED)
+    {
+        if (element == MATRIX_UINT16)
+            return f(DistanceMatrix<uint16_t, MATRIX_PACKED>(data, n));
+        if (element == MATRIX_INT32)
+            return f(DistanceMatrix<int32_t, MATRIX_PACKED>(data, n));
+        return f(DistanceMatrix<float, MATRIX_PACKED>(data, n));
+    }
+    if (element == MATRIX_UINT16)
+        return f(DistanceMatrix<uint16_t, MATRIX_FULL>(data, n));
+    if (element == MATRIX_INT32)
+        return f(DistanceMatrix<int32_t, MATRIX_FULL>(data, n));
+    return f(DistanceMatrix<float, MATRIX_FULL>(data, n));
+}
+
+/**
+ * @brief Bytes of a matrix of <n> cities
+ */
+inline size_t matrixBytes(MatrixElement element, MatrixLayout layout, int n)
+{
+    return withMatrix(element, layout, NULL, n, [n](auto matrix) {
+        return decltype(matrix)::cells(n) * sizeof(typename decltype(matrix)::element_type);
+    });
+}
+
+/// Releases memory allocated with posix_memalign
+struct AlignedFree
+{
+    void operator()(void *p) const { free(p); }
+};
+
+/// Owned memory of a matrix, aligned to MATRIX_ALIGNMENT
+typedef std::unique_ptr<void, AlignedFree> MatrixStorage;
+
+/**
+ * @brief Allocate the memory of a matrix (not initialized)
+ */
+inline MatrixStorage allocateMatrix(size_t bytes)
+{
+    void *p = NULL;
+    if (posix_memalign(&p, MATRIX_ALIGNMENT, std::max(bytes, (size_t)1)) != 0)
+        throw std::bad_alloc();
+    return MatrixStorage(p);
+}
+
+#endif /* MATRIX_H */
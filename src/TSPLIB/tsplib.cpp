@@ -9,134 +9,466 @@
  * 
  */
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
 #include "tsplib.h"
+#include "distance.h"
+#include "omp.h"
 
 using namespace std;
 
+/// Coordinate sections bigger than this are parsed by all OpenMP threads, each one a chunk of lines
+#define PARALLEL_SECTION_BYTES (1 << 20)
+
+/// Contents of a file, memory-mapped or read into a buffer when it can not be mapped
+struct FileView
+{
+    const char *data;
+    size_t size;
+    void *mapping;
+    vector<char> buffer;
+};
+
 /**
- * @brief Read TSPLIB problem into Map struct
- * 
- * @param inputFile input file stream 
- * @return Map Problem information
+ * @brief Map a whole file into memory
+ *
+ * @return false if the file can not be opened
  */
-Map readProblem(ifstream &inputFile)
+static bool openFile(const string &fileName, FileView &file)
 {
-    Map tsp;
-    const char delimiter = ':';
-    string line;
-    bool isMatrix = 0;
-    std::vector<City> cities;
-    while (inputFile)
-    {
-        getline(inputFile, line);
+    file.data = NULL;
+    file.size = 0;
+    file.mapping = NULL;
 
-        if (line == "EOF" || line == "DISPLAY_DATA_SECTION")
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        file.size = st.st_size;
+        void *mapping = mmap(NULL, file.size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED)
         {
-            break;
+            madvise(mapping, file.size, MADV_SEQUENTIAL);
+            file.mapping = mapping;
+            file.data = (const char *)mapping;
         }
-        if (line.find(delimiter) != string::npos)
+        else
         {
-            string keyword = line.substr(0, line.find(delimiter));
-            string value = line.substr(line.find(delimiter) + 1, line.npos);
-
-            checkKeyword(trim(keyword), trim(value), tsp.name, tsp.dimension);
+            file.buffer.resize(file.size);
+            file.size = read(fd, file.buffer.data(), file.size) == (ssize_t)file.size ? file.size : 0;
+            file.data = file.buffer.data();
         }
-        if (isMatrix)
-        {
-            stringstream stream(line);
-            City aux;
-            stream >> aux.index;
-            stream >> aux.x;
-            stream >> aux.y;
+    }
+    close(fd);
+    return true;
+}
 
-            cities.push_back(aux);
-        }
-        if (line == "NODE_COORD_SECTION")
+static void closeFile(FileView &file)
+{
+    if (file.mapping)
+        munmap(file.mapping, file.size);
+    file.mapping = NULL;
+}
+
+static inline bool isBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v';
+}
+
+/**
+ * @brief Parse the number that starts after the blanks at <p>
+ *
+ * @return position after the number, NULL if there is no number
+ */
+static inline const char *parseNumber(const char *p, const char *end, double &value)
+{
+    while (p < end && isBlank(*p))
+        p++;
+    if (p < end && *p == '+')
+        p++;
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    from_chars_result result = from_chars(p, end, value);
+    return result.ec == errc() ? result.ptr : NULL;
+#else
+    // strtod needs a terminated string, the mapped file is not
+    char token[64];
+    size_t length = 0;
+    while (p + length < end && !isBlank(p[length]) && length < sizeof(token) - 1)
+        length++;
+    memcpy(token, p, length);
+    token[length] = '\0';
+    char *stop;
+    value = strtod(token, &stop);
+    return stop == token ? NULL : p + (stop - token);
+#endif
+}
+
+/**
+ * @brief Start of the line after the one <p> is in (or <p> if it already starts a line)
+ */
+static inline const char *lineStart(const char *begin, const char *p, const char *end)
+{
+    if (p == begin || p[-1] == '\n')
+        return p;
+    const char *newline = (const char *)memchr(p, '\n', end - p);
+    return newline ? newline + 1 : end;
+}
+
+/**
+ * @brief End of a section of numbers: start of the first line that begins with a keyword (or end of the file)
+ */
+static const char *sectionEnd(const char *p, const char *end)
+{
+    while (p < end)
+    {
+        const char *q = p;
+        while (q < end && isBlank(*q) && *q != '\n')
+            q++;
+        if (q < end && isalpha((unsigned char)*q))
+            return p;
+        const char *newline = (const char *)memchr(q, '\n', end - q);
+        if (!newline)
+            return end;
+        p = newline + 1;
+    }
+    return end;
+}
+
+/**
+ * @brief Parse a NODE_COORD_SECTION (lines of index and 2 or 3 coordinates), in parallel chunks of lines if it is big
+ *
+ * @return position after the section
+ */
+static const char *parseCoordinates(const char *p, const char *end, Map &tsp)
+{
+    bool is3D = tsp.edgeWeightType == EUC_3D || tsp.edgeWeightType == MAX_3D || tsp.edgeWeightType == MAN_3D;
+    const char *stop = sectionEnd(p, end);
+    tsp.xData.assign(tsp.dimension + 1, 0.0);
+    tsp.yData.assign(tsp.dimension + 1, 0.0);
+    tsp.zData.assign(is3D ? tsp.dimension + 1 : 0, 0.0);
+    tsp.x = tsp.xData.data();
+    tsp.y = tsp.yData.data();
+    tsp.z = is3D ? tsp.zData.data() : NULL;
+
+    int chunks = stop - p > PARALLEL_SECTION_BYTES ? omp_get_max_threads() : 1;
+    bool valid = true;
+
+#pragma omp parallel for reduction(&& : valid) if (chunks > 1)
+    for (int chunk = 0; chunk < chunks; chunk++)
+    {
+        const char *q = lineStart(p, p + (stop - p) * chunk / chunks, stop);
+        const char *chunkEnd = lineStart(p, p + (stop - p) * (chunk + 1) / chunks, stop);
+
+        while (true)
         {
-            isMatrix = true;
+            while (q < chunkEnd && isBlank(*q))
+                q++;
+            if (q >= chunkEnd)
+                break;
+
+            double index, x, y, z = 0;
+            q = parseNumber(q, stop, index);
+            if (q)
+                q = parseNumber(q, stop, x);
+            if (q)
+                q = parseNumber(q, stop, y);
+            if (q && is3D)
+                q = parseNumber(q, stop, z);
+            if (!q)
+            {
+                valid = false;
+                break;
+            }
+
+            int city = (int)index;
+            if (city < 1 || city > tsp.dimension)
+                continue;
+            tsp.xData[city] = x;
+            tsp.yData[city] = y;
+            if (is3D)
+                tsp.zData[city] = z;
         }
     }
 
-    // init map
-    tsp.matrix = std::vector<std::vector<float>>(tsp.dimension + 1, std::vector<float>(tsp.dimension + 1, 0.0));
+    if (!valid)
+    {
+        cout << "Error : Malformed NODE_COORD_SECTION in " << tsp.name << endl;
+        exit(-1);
+    }
+    return stop;
+}
 
-    for (City c1 : cities)
+/**
+ * @brief Parse an EDGE_WEIGHT_SECTION into a full (dimension + 1)^2 row-major matrix of weights
+ *
+ * Column-wise formats list the same weights as the transposed row-wise format, both triangles are filled.
+ *
+ * @return position after the section
+ */
+static const char *parseEdgeWeights(const char *p, const char *end, Map &tsp, vector<float> &weights)
+{
+    int n = tsp.dimension;
+    size_t side = n + 1;
+    weights.assign(side * side, 0.0);
+
+    EdgeWeightFormat format = tsp.edgeWeightFormat;
+    if (format == UPPER_COL)
+        format = LOWER_ROW;
+    else if (format == LOWER_COL)
+        format = UPPER_ROW;
+    else if (format == UPPER_DIAG_COL)
+        format = LOWER_DIAG_ROW;
+    else if (format == LOWER_DIAG_COL)
+        format = UPPER_DIAG_ROW;
+
+    for (int i = 1; i <= n; i++)
     {
-        for (City c2 : cities)
+        int first = 1, last = n;
+        if (format == UPPER_ROW)
+            first = i + 1;
+        else if (format == UPPER_DIAG_ROW)
+            first = i;
+        else if (format == LOWER_ROW)
+            last = i - 1;
+        else if (format == LOWER_DIAG_ROW)
+            last = i;
+
+        for (int j = first; j <= last; j++)
         {
-            tsp.matrix.at(c1.index).at(c2.index) = sqrt(pow(c2.x - c1.x, 2) + pow(c2.y - c1.y, 2));
+            double weight;
+            p = parseNumber(p, end, weight);
+            if (!p)
+            {
+                cout << "Error : EDGE_WEIGHT_SECTION of " << tsp.name << " has less weights than its format needs" << endl;
+                exit(-1);
+            }
+            weights[i * side + j] = weight;
+            if (format != FULL_MATRIX)
+                weights[j * side + i] = weight;
         }
     }
+    return p;
+}
 
-    return tsp;
+/**
+ * @brief Parse a file that is only a square matrix of weights (jtsp and tspbenchmarks problems) into a full
+ * (dimension + 1)^2 row-major matrix of weights
+ */
+static void parseRawMatrix(const char *p, const char *end, Map &tsp, vector<float> &weights)
+{
+    vector<float> values;
+    double weight;
+    while ((p = parseNumber(p, end, weight)) != NULL)
+        values.push_back(weight);
+
+    int n = (int)sqrt((double)values.size());
+    while ((size_t)n * n < values.size())
+        n++;
+    if (n == 0 || (size_t)n * n != values.size())
+    {
+        cout << "Error : " << tsp.name << " is not a square matrix (" << values.size() << " weights)" << endl;
+        exit(-1);
+    }
+
+    tsp.dimension = n;
+    tsp.edgeWeightType = EXPLICIT;
+    tsp.edgeWeightFormat = FULL_MATRIX;
+    size_t side = n + 1;
+    weights.assign(side * side, 0.0);
+    for (int i = 1; i <= n; i++)
+        memcpy(&weights[i * side + 1], &values[(size_t)(i - 1) * n], n * sizeof(float));
 }
 
 /**
- * @brief Read TSPLIB solution into Map struct
- * 
- * @param inputFile input file stream
- * @param tsp Map struct where to read solution
+ * @brief Trimmed line starting at <p>, <p> is moved to the start of the next line
+ */
+static string nextLine(const char *&p, const char *end)
+{
+    const char *newline = (const char *)memchr(p, '\n', end - p);
+    const char *lineEnd = newline ? newline : end;
+    string line(p, lineEnd);
+    p = newline ? newline + 1 : end;
+    return trim(line);
+}
+
+/**
+ * @brief Read a problem into a Map struct
+ *
+ * Understands TSPLIB files (every EDGE_WEIGHT_TYPE but XRAY and SPECIAL, and every EDGE_WEIGHT_FORMAT) and files that
+ * are only a square matrix of weights (jtsp). The file is memory-mapped and numbers are parsed in place.
+ *
+ * @param fileName problem file
+ * @return Map Problem information
  */
-void readSolution(ifstream &inputFile, Map &tsp)
+Map readProblem(const string &fileName)
 {
-    const char delimiter = ':';
-    string line;
-    bool isSolution = 0;
-    std::vector<City> cities;
-    while (inputFile)
+    Map tsp;
+    tsp.name = fileName.substr(fileName.find_last_of('/') + 1);
+    tsp.name = tsp.name.substr(0, tsp.name.find_last_of('.'));
+    tsp.dimension = 0;
+    tsp.edgeWeightType = EUC_2D;
+    tsp.edgeWeightFormat = FULL_MATRIX;
+    tsp.symmetric = true;
+
+    FileView file;
+    if (!openFile(fileName, file))
     {
-        getline(inputFile, line);
+        cout << "Error : Input problem file (" << fileName << ") not found" << endl;
+        exit(-1);
+    }
+    const char *p = file.data, *end = file.data + file.size;
 
-        if (line == "EOF" || line == "DISPLAY_DATA_SECTION")
+    // Weights of problems without coordinates, stored in the compact matrix once the whole file is read
+    vector<float> weights;
+
+    const char *first = p;
+    while (first < end && isBlank(*first))
+        first++;
+
+    if (first < end && !isalpha((unsigned char)*first))
+    {
+        parseRawMatrix(p, end, tsp, weights);
+    }
+    else
+    {
+        while (p < end)
         {
-            break;
+            string line = nextLine(p, end);
+
+            if (line == "EOF")
+            {
+                break;
+            }
+            if (line.find(':') != string::npos)
+            {
+                string keyword = line.substr(0, line.find(':'));
+                string value = line.substr(line.find(':') + 1, line.npos);
+
+                checkKeyword(trim(keyword), trim(value), tsp);
+            }
+            else if (line == "NODE_COORD_SECTION")
+            {
+                p = parseCoordinates(p, end, tsp);
+            }
+            else if (line == "EDGE_WEIGHT_SECTION")
+            {
+                p = parseEdgeWeights(p, end, tsp, weights);
+            }
+            else if (line != "")
+            {
+                // DISPLAY_DATA_SECTION, FIXED_EDGES_SECTION... are not used
+                p = sectionEnd(p, end);
+            }
         }
-        if (line.find(delimiter) != string::npos)
-        {
-            string keyword = line.substr(0, line.find(delimiter));
-            string value = line.substr(line.find(delimiter) + 1, line.npos);
+    }
+    closeFile(file);
 
-            checkKeyword(trim(keyword), trim(value), tsp.name, tsp.dimension);
-        }
-        if (isSolution)
+    if (tsp.dimension < 1)
+    {
+        cout << "Error : " << fileName << " has no DIMENSION" << endl;
+        exit(-1);
+    }
+
+    if (tsp.edgeWeightType == GEO)
+    {
+#pragma omp parallel for
+        for (int i = 1; i <= tsp.dimension; i++)
         {
-            stringstream stream(line);
-            City aux;
-            /* DEBUG */ // cout << "reading: " << line << endl;
-            stream >> aux.index;
-            cities.push_back(aux);
+            tsp.xData[i] = geoRadians(tsp.xData[i]);
+            tsp.yData[i] = geoRadians(tsp.yData[i]);
         }
-        if (line == "TOUR_SECTION")
+    }
+
+    // Weights given explicitly may be asymmetric (ATSP and jtsp problems)
+    if (tsp.edgeWeightType == EXPLICIT)
+    {
+        if (weights.empty())
         {
-            isSolution = true;
+            cout << "Error : " << fileName << " has no EDGE_WEIGHT_SECTION" << endl;
+            exit(-1);
         }
+
+        size_t side = tsp.dimension + 1;
+        for (int i = 1; i <= tsp.dimension && tsp.symmetric; i++)
+            for (int j = i + 1; j <= tsp.dimension; j++)
+                if (weights[i * side + j] != weights[j * side + i])
+                {
+                    tsp.symmetric = false;
+                    break;
+                }
+        storeMatrix(tsp, weights);
     }
 
-    bool first = true;
-    City c1, c2;
+    // Dense matrix or lazy distances, whatever is cheaper for the problem
+    buildDistances(tsp);
+
+    return tsp;
+}
+
+/**
+ * @brief Read the optimal tour of a problem into Map struct
+ *
+ * The cost comes from the TSPLIB tour <inputName>.opt.tour or, if there is none, from the "Minimal tour length" of
+ * the jtsp solution <inputName>.sol. It is 0 if there is no solution file.
+ *
+ * @param inputName problem path without extension
+ * @param tsp Map struct where to read solution
+ */
+void readSolution(const string &inputName, Map &tsp)
+{
     tsp.optimalCost = 0.0;
-    for (City c1 : cities)
+
+    FileView file;
+    if (openFile(inputName + ".opt.tour", file))
     {
-        /* DEBUG */ // cout << "-" << c1.index << "-" << endl;
-        if (first)
-        {
-            first = false;
-            c2 = c1;
-            /* DEBUG */ // cout << "primero" << endl;
-            continue;
-        }
-        if (c1.index == -1)
+        const char *p = file.data, *end = file.data + file.size;
+        vector<int> tour;
+        while (p < end)
         {
-            /* DEBUG */ // cout << "ultimo" << endl;
+            string line = nextLine(p, end);
+            if (line == "EOF")
+                break;
+            if (line != "TOUR_SECTION")
+                continue;
+
+            double city;
+            while ((p = parseNumber(p, end, city)) != NULL && city != -1)
+                tour.push_back((int)city);
             break;
         }
+        closeFile(file);
 
-        /* DEBUG */ // cout << "sumar: " <<tsp.matrix.at(c1.index).at(c2.index) << endl;
-        tsp.optimalCost += tsp.matrix.at(c1.index).at(c2.index);
-        c2 = c1;
+        // Tour is closed back to the first city
+        for (size_t i = 0; i < tour.size(); i++)
+            tsp.optimalCost += getDistance(tsp, tour[i], tour[(i + 1) % tour.size()]);
+        return;
     }
 
-    return;
+    if (openFile(inputName + ".sol", file))
+    {
+        const char *p = file.data, *end = file.data + file.size;
+        while (p < end)
+        {
+            string line = nextLine(p, end);
+            if (line.find(':') != string::npos && trim(line.substr(0, line.find(':'))) == "Minimal tour length")
+            {
+                tsp.optimalCost = stod(line.substr(line.find(':') + 1));
+                break;
+            }
+        }
+        closeFile(file);
+        return;
+    }
+
+    cout << "Error : Input solution file (" << inputName << ".opt.tour or " << inputName << ".sol) not found" << endl;
 }
 
 /**
@@ -157,29 +489,46 @@ string trim(string s)
  * 
  * @param keyword 
  * @param value 
- * @param name name of TSPLIB problem
- * @param dimension dimension of TSPLIB problem
+ * @param tsp TSPLIB problem where to store name, dimension, type and edge weight type and format
  * @return true if a known keyword has been detected
  * @return false if a unknow keyword has been detected
  */
-bool checkKeyword(string keyword, string value, string &name, int &dimension)
+bool checkKeyword(string keyword, string value, Map &tsp)
 {
     if (keyword == "NAME")
     {
-        name = value;
+        tsp.name = value;
     }
     else if (keyword == "DIMENSION")
     {
-        dimension = stoi(value);
+        tsp.dimension = stoi(value);
     }
     else if (keyword == "COMMENT")
     {
     }
     else if (keyword == "TYPE")
     {
+        if (value == "ATSP")
+            tsp.symmetric = false;
     }
     else if (keyword == "EDGE_WEIGHT_TYPE")
     {
+        const char *types[] = {"EUC_2D", "EUC_3D", "MAX_2D", "MAX_3D", "MAN_2D", "MAN_3D", "CEIL_2D", "ATT", "GEO", "EXPLICIT"};
+        int type = find(types, types + 10, value) - types;
+        if (type == 10)
+        {
+            cout << "Error : Unsupported EDGE_WEIGHT_TYPE " << value << endl;
+            exit(-1);
+        }
+        tsp.edgeWeightType = (EdgeWeightType)type;
+    }
+    else if (keyword == "EDGE_WEIGHT_FORMAT")
+    {
+        const char *formats[] = {"FULL_MATRIX", "UPPER_ROW", "LOWER_ROW", "UPPER_DIAG_ROW", "LOWER_DIAG_ROW",
+                                 "UPPER_COL", "LOWER_COL", "UPPER_DIAG_COL", "LOWER_DIAG_COL"};
+        int format = find(formats, formats + 9, value) - formats;
+        // FUNCTION: weights come from the EDGE_WEIGHT_TYPE
+        tsp.edgeWeightFormat = format == 9 ? FULL_MATRIX : (EdgeWeightFormat)format;
     }
     else
     {
@@ -217,15 +566,35 @@ string getParam(string cmd, int argc, char **argv)
     return "";
 }
 
+/**
+ * @brief Check if a flag (option without value) is in the command line arguments
+ * 
+ * @param cmd flag to be parsed
+ * @param argc 
+ * @param argv 
+ * @return true if the flag is present
+ */
+bool getFlag(string cmd, int argc, char **argv)
+{
+    for (int i = 0; i < argc; i++)
+    {
+        if (argv[i] == cmd)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
 /**
  * @brief Parse command line options
  * 
  * @param argc 
  * @param argv 
- * @param problemFileStream references to input file stream for problem
- * @param solutionFileStream references to input file stream for solution
+ * @param inputName reference to the path of the problem without extension (<inputName>.tsp)
+ * @param options references to the parameters of the Genetic Algorithm
  */
-void parseArgs(int argc, char **argv, std::ifstream &problemFileStream, std::ifstream &solutionFileStream, int &POPULATION_SIZE, int &CHILD_PER_GNOME, int &MAX_NUMBER_MUTATIONS, int &NUMBER_GENERATIONS, int &GEN_BATCH, bool &SYNC_BATCH)
+void parseArgs(int argc, char **argv, std::string &inputName, Options &options)
 {
 
     string helpParam = getParam("-h", argc, argv);
@@ -243,12 +612,58 @@ void parseArgs(int argc, char **argv, std::ifstream &problemFileStream, std::ifs
              << endl
              << "-B <GEN_BATCH>"
              << endl
-             << "-S <SYNC_BATCH>" << endl;
+             << "-S <SYNC_BATCH>"
+             << endl
+             << "--overlap"
+             << endl
+             << "--seed <SEED>"
+             << endl
+             << "--deterministic"
+             << endl
+             << "-L <LOCAL_SEARCH> (none, elite, children)"
+             << endl
+             << "-X <CROSSOVER> (none, ox, pmx, eax)"
+             << endl
+             << "--steady"
+             << endl
+             << "--candidates <CANDIDATES>"
+             << endl
+             << "--seeding <SEEDING> (fraction of the initial population)"
+             << endl
+             << "-I <ISLAND> (ring, torus, random)"
+             << endl
+             << "--migrants <MIGRANTS>"
+             << endl
+             << "--trace <TRACE_FILE> (Chrome trace, make PROFILE=1)"
+             << endl
+             << "--log <LOG_LEVEL> (0 nothing, 1 fittest after each batch, 2 also its tour at the end)"
+             << endl
+             << "--telemetry <TELEMETRY_FILE> (CSV, binary if it ends in .bin)"
+             << endl
+             << "--batch <COLLECTION_FILE> (instead of -i)"
+             << endl
+             << "--exact <EXACT> (cities of the biggest problem solved exactly, 0 never)"
+             << endl
+             << "--checkpoint <CHECKPOINT_FILE> (<CHECKPOINT_FILE>.<rank> for every node)"
+             << endl
+             << "--checkpoint-every <CHECKPOINT_EVERY> (batches)"
+             << endl
+             << "--resume <CHECKPOINT_FILE>"
+             << endl
+             << "--gap <GAP> (percent above the lower bound of the optimal tour)"
+             << endl
+             << "--stall <STALL> (batches without a fitter tour)"
+             << endl
+             << "--time <TIME_LIMIT> (seconds)"
+             << endl
+             << "--dedup" << endl;
         exit(0);
     }
 
+    options.BATCH_FILE = getParam("--batch", argc, argv);
+
     string inputParam = getParam("-i", argc, argv);
-    if (inputParam == "")
+    if (inputParam == "" && options.BATCH_FILE == "")
     {
         cout << "Error : -i <INPUT_FILE> parameter not detected" << endl;
         exit(-1);
@@ -262,7 +677,7 @@ void parseArgs(int argc, char **argv, std::ifstream &problemFileStream, std::ifs
     }
     else
     {
-        POPULATION_SIZE = stoi(POPULATION_SIZE_string);
+        options.POPULATION_SIZE = stoi(POPULATION_SIZE_string);
     }
 
     string CHILD_PER_GNOME_string = getParam("-C", argc, argv);
@@ -273,7 +688,7 @@ void parseArgs(int argc, char **argv, std::ifstream &problemFileStream, std::ifs
     }
     else
     {
-        CHILD_PER_GNOME = stoi(CHILD_PER_GNOME_string);
+        options.CHILD_PER_GNOME = stoi(CHILD_PER_GNOME_string);
     }
 
     string MAX_NUMBER_MUTATIONS_string = getParam("-M", argc, argv);
@@ -284,7 +699,7 @@ void parseArgs(int argc, char **argv, std::ifstream &problemFileStream, std::ifs
     }
     else
     {
-        MAX_NUMBER_MUTATIONS = stoi(MAX_NUMBER_MUTATIONS_string);
+        options.MAX_NUMBER_MUTATIONS = stoi(MAX_NUMBER_MUTATIONS_string);
     }
 
     string NUMBER_GENERATIONS_string = getParam("-G", argc, argv);
@@ -295,7 +710,7 @@ void parseArgs(int argc, char **argv, std::ifstream &problemFileStream, std::ifs
     }
     else
     {
-        NUMBER_GENERATIONS = stoi(NUMBER_GENERATIONS_string);
+        options.NUMBER_GENERATIONS = stoi(NUMBER_GENERATIONS_string);
     }
 
     string GEN_BATCH_string = getParam("-B", argc, argv);
@@ -306,27 +721,162 @@ void parseArgs(int argc, char **argv, std::ifstream &problemFileStream, std::ifs
     }
     else
     {
-        GEN_BATCH = stoi(GEN_BATCH_string);
+        options.GEN_BATCH = stoi(GEN_BATCH_string);
     }
 
     string SYNC_BATCH_string = getParam("-S", argc, argv);
-    SYNC_BATCH = (SYNC_BATCH_string == "sync");
+    options.SYNC_BATCH = (SYNC_BATCH_string == "sync");
+    options.OVERLAP = getFlag("--overlap", argc, argv);
+    if (options.OVERLAP && !options.SYNC_BATCH)
+    {
+        cout << "Error : --overlap needs -S <SYNC_BATCH>" << endl;
+        exit(-1);
+    }
 
-    string problemFile = inputParam + ".tsp";
-    problemFileStream = ifstream(problemFile);
+    string SEED_string = getParam("--seed", argc, argv);
+    options.SEEDED = SEED_string != "";
+    options.SEED = options.SEEDED ? stoull(SEED_string) : 0;
 
-    string solutionFile = inputParam + ".opt.tour";
-    solutionFileStream = ifstream(solutionFile);
+    options.DETERMINISTIC = getFlag("--deterministic", argc, argv);
 
-    if (!problemFileStream)
+    string LOCAL_SEARCH_string = getParam("-L", argc, argv);
+    if (LOCAL_SEARCH_string == "" || LOCAL_SEARCH_string == "none")
+        options.LOCAL_SEARCH = LS_NONE;
+    else if (LOCAL_SEARCH_string == "elite")
+        options.LOCAL_SEARCH = LS_ELITE;
+    else if (LOCAL_SEARCH_string == "children")
+        options.LOCAL_SEARCH = LS_CHILDREN;
+    else
     {
-        cout << "Error : Input problem file (" << inputParam << ".tsp) not found" << endl;
+        cout << "Error : -L <LOCAL_SEARCH> must be none, elite or children" << endl;
         exit(-1);
     }
 
-    if (!solutionFileStream)
+    string CROSSOVER_string = getParam("-X", argc, argv);
+    if (CROSSOVER_string == "" || CROSSOVER_string == "none")
+        options.CROSSOVER = CROSSOVER_NONE;
+    else if (CROSSOVER_string == "ox")
+        options.CROSSOVER = CROSSOVER_OX;
+    else if (CROSSOVER_string == "pmx")
+        options.CROSSOVER = CROSSOVER_PMX;
+    else if (CROSSOVER_string == "eax")
+        options.CROSSOVER = CROSSOVER_EAX;
+    else
     {
-        cout << "Error : Input solution file (" << inputParam << ".opt.tour) not found" << endl;
+        cout << "Error : -X <CROSSOVER> must be none, ox, pmx or eax" << endl;
+        exit(-1);
+    }
+
+    options.STEADY_STATE = getFlag("--steady", argc, argv);
+
+    string CANDIDATES_string = getParam("--candidates", argc, argv);
+    options.CANDIDATES = CANDIDATES_string == "" ? 8 : stoi(CANDIDATES_string);
+
+    string SEEDING_string = getParam("--seeding", argc, argv);
+    options.SEEDING = SEEDING_string == "" ? 0 : stod(SEEDING_string);
+    if (options.SEEDING < 0 || options.SEEDING > 1)
+    {
+        cout << "Error : --seeding <SEEDING> must be a fraction between 0 and 1" << endl;
+        exit(-1);
+    }
+
+    string ISLAND_string = getParam("-I", argc, argv);
+    if (ISLAND_string == "")
+        options.ISLAND = MIGRATION_NONE;
+    else if (ISLAND_string == "ring")
+        options.ISLAND = MIGRATION_RING;
+    else if (ISLAND_string == "torus")
+        options.ISLAND = MIGRATION_TORUS;
+    else if (ISLAND_string == "random")
+        options.ISLAND = MIGRATION_RANDOM;
+    else
+    {
+        cout << "Error : -I <ISLAND> must be ring, torus or random" << endl;
+        exit(-1);
+    }
+
+    if (options.ISLAND != MIGRATION_NONE && options.SYNC_BATCH)
+    {
+        cout << "Error : -I <ISLAND> and -S <SYNC_BATCH> can not be used together" << endl;
+        exit(-1);
+    }
+
+    string MIGRANTS_string = getParam("--migrants", argc, argv);
+    options.MIGRANTS = MIGRANTS_string == "" ? 2 : stoi(MIGRANTS_string);
+    if (options.MIGRANTS < 1)
+    {
+        cout << "Error : --migrants <MIGRANTS> must be at least 1" << endl;
+        exit(-1);
+    }
+
+    options.TRACE_FILE = getParam("--trace", argc, argv);
+
+    string LOG_LEVEL_string = getParam("--log", argc, argv);
+    options.LOG_LEVEL = LOG_LEVEL_string == "" ? 1 : stoi(LOG_LEVEL_string);
+    if (options.LOG_LEVEL < 0 || options.LOG_LEVEL > 2)
+    {
+        cout << "Error : --log <LOG_LEVEL> must be 0, 1 or 2" << endl;
+        exit(-1);
+    }
+
+    options.TELEMETRY_FILE = getParam("--telemetry", argc, argv);
+
+    // Held-Karp needs n^2 2^n time and n 2^n memory, 24 cities take 386 MB and 30 would take 31 GB (HELD_KARP_LIMIT)
+    string EXACT_string = getParam("--exact", argc, argv);
+    options.EXACT = EXACT_string == "" ? 20 : stoi(EXACT_string);
+    if (options.EXACT < 0 || options.EXACT > 24)
+    {
+        cout << "Error : --exact <EXACT> must be between 0 and 24" << endl;
+        exit(-1);
+    }
+
+    options.CHECKPOINT_FILE = getParam("--checkpoint", argc, argv);
+    string CHECKPOINT_EVERY_string = getParam("--checkpoint-every", argc, argv);
+    options.CHECKPOINT_EVERY = CHECKPOINT_EVERY_string == "" ? 10 : stoi(CHECKPOINT_EVERY_string);
+    if (options.CHECKPOINT_EVERY < 1)
+    {
+        cout << "Error : --checkpoint-every <CHECKPOINT_EVERY> must be at least 1" << endl;
+        exit(-1);
+    }
+    options.RESUME_FILE = getParam("--resume", argc, argv);
+    options.DEDUP = getFlag("--dedup", argc, argv);
+
+    // Stopping rules, checked after every batch, the run stops at NUMBER_GENERATIONS anyway
+    string GAP_string = getParam("--gap", argc, argv);
+    options.GAP = GAP_string == "" ? -1 : stod(GAP_string);
+    if (GAP_string != "" && options.GAP < 0)
+    {
+        cout << "Error : --gap <GAP> must be a percentage of at least 0" << endl;
+        exit(-1);
+    }
+    string STALL_string = getParam("--stall", argc, argv);
+    options.STALL = STALL_string == "" ? 0 : stoi(STALL_string);
+    if (options.STALL < 0)
+    {
+        cout << "Error : --stall <STALL> must be at least 0" << endl;
+        exit(-1);
+    }
+    string TIME_LIMIT_string = getParam("--time", argc, argv);
+    options.TIME_LIMIT = TIME_LIMIT_string == "" ? 0 : stod(TIME_LIMIT_string);
+    if (options.TIME_LIMIT < 0)
+    {
+        cout << "Error : --time <TIME_LIMIT> must be at least 0" << endl;
+        exit(-1);
+    }
+
+    inputName = inputParam;
+    if (options.BATCH_FILE != "")
+    {
+        if (!ifstream(options.BATCH_FILE))
+        {
+            cout << "Error : Collection file (" << options.BATCH_FILE << ") not found" << endl;
+            exit(-1);
+        }
+    }
+    else if (!ifstream(inputParam + ".tsp"))
+    {
+        cout << "Error : Input problem file (" << inputParam << ".tsp) not found" << endl;
+        exit(-1);
     }
 
     return;
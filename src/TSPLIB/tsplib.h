@@ -20,27 +20,154 @@
 #include <ctime>
 #include <algorithm>
 #include <sstream>
+#include "kdtree.h"
+#include "matrix.h"
 
+/// Distance function of a problem (TSPLIB EDGE_WEIGHT_TYPE)
+enum EdgeWeightType
+{
+    EUC_2D,
+    EUC_3D,
+    MAX_2D,
+    MAX_3D,
+    MAN_2D,
+    MAN_3D,
+    CEIL_2D,
+    ATT,
+    GEO,
+    EXPLICIT
+};
+
+/// Layout of the weights of an EXPLICIT problem (TSPLIB EDGE_WEIGHT_FORMAT)
+enum EdgeWeightFormat
+{
+    FULL_MATRIX,
+    UPPER_ROW,
+    LOWER_ROW,
+    UPPER_DIAG_ROW,
+    LOWER_DIAG_ROW,
+    UPPER_COL,
+    LOWER_COL,
+    UPPER_DIAG_COL,
+    LOWER_DIAG_COL
+};
+
+/// Storage used to answer distance queries of a problem
+enum DistanceBackend
+{
+    DENSE_MATRIX,    // (dimension + 1)^2 precomputed distances
+    LAZY_COORDINATES // Distances computed on demand from the coordinates
+};
+
+/**
+ * @brief TSP problem
+ *
+ * Arrays are read through pointers into the owned vectors of the map or into a binary cache mapped in memory, which
+ * every process of a node shares. Maps can be moved but not copied.
+ */
 struct Map
 {
     std::string name;
     int dimension;
-    std::vector<std::vector<float>> matrix;
+    EdgeWeightType edgeWeightType;
+    EdgeWeightFormat edgeWeightFormat;
+    bool symmetric;                      // d(i, j) == d(j, i) for every pair of cities
+    DistanceBackend backend;
+    const double *x, *y, *z;             // Coordinates of city i in x[i], y[i] (radians for GEO), z[i] (NULL in 2D), index 0 unused
+    const void *matrix;                  // Dense matrix of matrixElement distances in matrixLayout, only for DENSE_MATRIX
+    MatrixElement matrixElement;
+    MatrixLayout matrixLayout;
+    int neighbourK;                      // Number of cached neighbours per city (0 if no cache)
+    const int *neighbours;               // Nearest cities of city i in [i * neighbourK, (i + 1) * neighbourK)
+    const float *neighbourDistance;      // Distances to the cities of neighbours
+    KdTree index;                        // Spatial index over the coordinates (points on the unit sphere for GEO)
     float optimalCost;
+
+    // Memory of the arrays that are not mapped from a cache
+    std::vector<double> xData, yData, zData;
+    MatrixStorage matrixData;
+    std::vector<int> neighboursData;
+    std::vector<float> neighbourDistanceData;
+
+    void *cache;      // Binary cache mapped in memory, NULL if the problem was parsed
+    size_t cacheSize;
+
+    Map() : dimension(0), edgeWeightType(EUC_2D), edgeWeightFormat(FULL_MATRIX), symmetric(true), backend(DENSE_MATRIX),
+            x(NULL), y(NULL), z(NULL), matrix(NULL), matrixElement(MATRIX_FLOAT), matrixLayout(MATRIX_FULL),
+            neighbourK(0), neighbours(NULL), neighbourDistance(NULL), optimalCost(0), cache(NULL), cacheSize(0) {}
+    Map(const Map &) = delete;
+    Map &operator=(const Map &) = delete;
+    Map(Map &&) = default;
+    Map &operator=(Map &&) = default;
+};
+
+/// Individuals improved by local search in the Genetic Algorithm
+enum LocalSearchMode
+{
+    LS_NONE,
+    LS_ELITE,   // Fittest individual of each generation
+    LS_CHILDREN // Every child after its mutations
+};
+
+/// Operator that combines two parents into a child in the Genetic Algorithm
+enum CrossoverOperator
+{
+    CROSSOVER_NONE, // Children are mutated copies of one parent
+    CROSSOVER_OX,   // Order crossover
+    CROSSOVER_PMX,  // Partially mapped crossover
+    CROSSOVER_EAX   // Edge assembly crossover (symmetric problems)
+};
+
+/// Neighbours each island (MPI node) sends its fittest individuals to in island mode
+enum MigrationTopology
+{
+    MIGRATION_NONE,  // No islands (nodes synchronize with SYNC_BATCH or not at all)
+    MIGRATION_RING,  // Next node
+    MIGRATION_TORUS, // Four neighbours in a 2D grid of nodes
+    MIGRATION_RANDOM // A random node every time
 };
 
-struct City
+/// Parameters of the Genetic Algorithm parsed from the command line
+struct Options
 {
-    int index;
-    float x, y; // Coordinates
+    int POPULATION_SIZE;
+    int CHILD_PER_GNOME;
+    int MAX_NUMBER_MUTATIONS;
+    int NUMBER_GENERATIONS;
+    int GEN_BATCH;
+    bool SYNC_BATCH;
+    bool OVERLAP;            // Overlap SYNC_BATCH with the computation of the next batch
+    bool SEEDED;             // SEED given in the command line
+    unsigned long long SEED; // Seed of the random number streams
+    bool DETERMINISTIC;      // Same seed, MPI size and threads reproduce the run bit for bit
+    LocalSearchMode LOCAL_SEARCH;
+    CrossoverOperator CROSSOVER;
+    bool STEADY_STATE;       // Threads breed children into a shared pool without generation barriers
+    int CANDIDATES;          // Nearest neighbours per city considered by the local search
+    double SEEDING;          // Fraction of the initial population built by construction heuristics
+    MigrationTopology ISLAND;
+    int MIGRANTS;            // Fittest individuals each island sends to its neighbours after each batch
+    std::string TRACE_FILE;  // Chrome trace of the phases of all nodes (profiler compiled in)
+    int LOG_LEVEL;           // 0 nothing, 1 fittest of every node after each batch, 2 also the tour of the fittest at the end
+    std::string TELEMETRY_FILE; // Records of every node after each batch, CSV or binary (.bin)
+    std::string BATCH_FILE;  // Collection of problems solved one after another instead of INPUT_FILE
+    int EXACT;               // Problems of up to this many cities are solved exactly (Held-Karp), 0 never
+    std::string CHECKPOINT_FILE; // State of every node saved in <CHECKPOINT_FILE>.<rank>
+    int CHECKPOINT_EVERY;    // Batches between two checkpoints
+    std::string RESUME_FILE; // Checkpoint of a previous run to resume
+    double GAP;              // Stop when the fittest tour is within GAP percent of the lower bound, negative never
+    int STALL;               // Stop after STALL batches without a fitter tour, 0 never
+    double TIME_LIMIT;       // Stop after the batch that exceeds TIME_LIMIT seconds, 0 never
+    bool DEDUP;              // Copies of a tour never take more than one parent slot, evaluated tours are cached
 };
 
-Map readProblem(std::ifstream &inputFile);
-void readSolution(std::ifstream &inputFile, Map &tsp);
+Map readProblem(const std::string &fileName);
+void readSolution(const std::string &inputName, Map &tsp);
 std::string trim(std::string s);
-bool checkKeyword(std::string keyword, std::string value, std::string &name, int &dimension);
+bool checkKeyword(std::string keyword, std::string value, Map &tsp);
 void printSolution(Map &tsp, float optimalTourSize, float optimalTourCost);
 std::string getParam(std::string cmd, int argc, char **argv);
-void parseArgs(int argc, char **argv, std::ifstream &problemFileStream, std::ifstream &solutionFileStream, int &POPULATION_SIZE, int &CHILD_PER_GNOME, int &MAX_NUMBER_MUTATIONS, int &NUMBER_GENERATIONS, int &GEN_BATCH, bool &SYNC_BATCH);
+bool getFlag(std::string cmd, int argc, char **argv);
+void parseArgs(int argc, char **argv, std::string &inputName, Options &options);
 
 #endif /* TSPLIB_H */
\ No newline at end of file
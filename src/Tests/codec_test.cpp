@@ -0,0 +1,121 @@
+/**
+ * @file codec_test.cpp
+ * @author Javier Vela
+ * @brief Round trip of the wire format of the tours: every encoding is decoded again and compared with the original
+ * @version 0.1
+ * @date 2022-01-09
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "codec.h"
+#include "random.h"
+
+using namespace std;
+
+/**
+ * @brief Random tour of cities 1 ... n
+ */
+static void random_tour(gene_t *tour, int n, Rng &rng)
+{
+	for (int i = 0; i < n; i++)
+		tour[i] = i + 1;
+	for (int i = n - 1; i > 0; i--)
+		swap(tour[i], tour[rand_num(rng, 0, i + 1)]);
+}
+
+/**
+ * @brief Encode <size> tours of <n> cities, decode them and compare
+ *
+ * @param name name of the case in the errors
+ * @param reference whether the codec has a reference tour, the tours are then copies of it with <swaps> random swaps
+ * @param expected encoding every tour must be sent with
+ * @return number of errors
+ */
+static int round_trip(const string &name, int n, int size, bool reference, int swaps, TourEncoding expected, Rng &rng)
+{
+	TourCodec sender, receiver;
+	init_codec(sender, n);
+	init_codec(receiver, n);
+
+	Population population, decoded;
+	resize_population(population, size, n);
+	resize_population(decoded, size, n);
+	vector<gene_t> reference_tour(n);
+	random_tour(reference_tour.data(), n, rng);
+	if (reference)
+	{
+		set_codec_reference(sender, reference_tour.data());
+		set_codec_reference(receiver, reference_tour.data());
+	}
+
+	population.order.resize(size);
+	for (int i = 0; i < size; i++)
+	{
+		gene_t *tour = gnome(population, i);
+		if (reference)
+		{
+			memcpy(tour, reference_tour.data(), n * sizeof(gene_t));
+			for (int s = 0; s < swaps; s++)
+				swap(tour[rand_num(rng, 0, n)], tour[rand_num(rng, 0, n)]);
+		}
+		else
+			random_tour(tour, n, rng);
+		population.fitness[i] = 1000.0f + i;
+		population.order[i] = size - 1 - i;
+	}
+
+	vector<uint8_t> buffer;
+	encode_population(sender, population, size, buffer);
+	int decoded_n = decode_population(receiver, buffer.data(), decoded, 0, size);
+	if (decoded_n != size)
+	{
+		cout << "Error : " << name << " decoded " << decoded_n << " of " << size << " tours" << endl;
+		return 1;
+	}
+
+	// Encoding of the first tour, after the count (varint) and its fitness
+	size_t count_bytes = 1;
+	for (int c = size; c >= 0x80; c >>= 7)
+		count_bytes++;
+	if (buffer[count_bytes + sizeof(float)] != expected)
+	{
+		cout << "Error : " << name << " sent with encoding " << (int)buffer[count_bytes + sizeof(float)] << " instead of " << expected << endl;
+		return 1;
+	}
+
+	for (int i = 0; i < size; i++)
+	{
+		int indi = population.order[i];
+		if (decoded.fitness[i] != population.fitness[indi] || memcmp(gnome(decoded, i), gnome(population, indi), n * sizeof(gene_t)) != 0)
+		{
+			cout << "Error : " << name << " tour " << i << " does not survive encoding" << endl;
+			return 1;
+		}
+	}
+	cout << name << " : " << size << " tours, " << buffer.size() << " bytes" << endl;
+	return 0;
+}
+
+int main()
+{
+	Rng rng = stream_rng(1, 0);
+	int errors = 0;
+	errors += round_trip("raw16", 1000, 20, false, 0, TOUR_RAW16, rng);
+	errors += round_trip("raw16 with reference", 1000, 20, true, 1000, TOUR_RAW16, rng);
+	errors += round_trip("edge difference", 1000, 20, true, 10, TOUR_EDGE_DIFF, rng);
+	errors += round_trip("edge difference of the reference", 1000, 3, true, 0, TOUR_EDGE_DIFF, rng);
+	errors += round_trip("edge difference of 200 tours", 65535, 200, true, 5, TOUR_EDGE_DIFF, rng);
+	// Unrelated tours of 32-bit ids are still smaller as edge differences (city varints of 3 bytes, runs of 1)
+	if (MAX_GENE_CITY > 65535)
+	{
+		errors += round_trip("raw32", 70000, 3, false, 0, TOUR_RAW32, rng);
+		errors += round_trip("edge difference of 70000 cities", 70000, 3, true, 10, TOUR_EDGE_DIFF, rng);
+	}
+	return errors == 0 ? 0 : -1;
+}
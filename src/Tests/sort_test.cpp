@@ -0,0 +1,79 @@
+/**
+ * @file sort_test.cpp
+ * @author Javier Vela
+ * @brief Sorting of the populations by fitness, with the parallel radix sort on several threads
+ * @version 0.1
+ * @date 2022-01-09
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "population.h"
+#include "random.h"
+#include "omp.h"
+
+using namespace std;
+
+/**
+ * @brief Sort <size> individuals with random fitness (<distinct> different values) on <threads> threads and check
+ * that the order is a permutation, by fitness and, for ties, by index
+ *
+ * @return number of errors
+ */
+static int check_sort(int size, int distinct, int threads, Rng &rng)
+{
+	Population p;
+	resize_population(p, size, 1);
+	for (int i = 0; i < size; i++)
+	{
+		*gnome(p, i) = i;
+		p.fitness[i] = rand_num(rng, 0, distinct) * 0.5f - distinct / 4;
+	}
+
+	omp_set_num_threads(threads);
+	sort_population(p);
+
+	string name = to_string(size) + " individuals on " + to_string(threads) + " threads";
+	vector<char> seen(size, 0);
+	long long inversions = 0;
+	for (int r = 0; r < size; r++)
+	{
+		int i = p.order[r];
+		if (i < 0 || i >= size || seen[i])
+		{
+			cout << "Error : " << name << ", order is not a permutation at rank " << r << endl;
+			return 1;
+		}
+		seen[i] = 1;
+		if (r > 0)
+		{
+			int prev = p.order[r - 1];
+			inversions += p.fitness[prev] > p.fitness[i] || (p.fitness[prev] == p.fitness[i] && prev > i);
+		}
+	}
+	if (inversions > 0)
+	{
+		cout << "Error : " << name << ", " << inversions << " individuals out of order" << endl;
+		return 1;
+	}
+	cout << name << " : sorted" << endl;
+	return 0;
+}
+
+int main()
+{
+	Rng rng = stream_rng(1, 0);
+	int errors = 0;
+	for (int threads : {1, 2, 3, 4, 8})
+	{
+		errors += check_sort(100000, 1 << 30, threads, rng);
+		errors += check_sort(100000, 1000, threads, rng);
+	}
+	errors += check_sort(RADIX_SORT_MIN_SIZE, 1 << 30, 3, rng);
+	errors += check_sort(1000, 1 << 30, 4, rng);
+	return errors == 0 ? 0 : -1;
+}
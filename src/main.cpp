@@ -14,7 +14,11 @@
 #include <algorithm>
 #include <chrono>
 #include "tsplib.h"
+#include "cache.h"
 #include "genetic.h"
+#include "heldkarp.h"
+#include "batch.h"
+#include "profiler.h"
 #include "mpi.h"
 
 using namespace std;
@@ -38,7 +42,13 @@ using namespace std::chrono;
  */
 int main(int argc, char **argv)
 {
-	MPI_Init(&argc, &argv);
+	// Synchronizations overlapped with the computation call MPI from a communication thread, batches from every thread.
+	// Telemetry is sent by the main thread while the communication thread synchronizes.
+	bool batch = getParam("--batch", argc, argv) != "";
+	bool overlap = getFlag("--overlap", argc, argv), telemetry = getParam("--telemetry", argc, argv) != "";
+	int mpi_thread_level = batch || (overlap && telemetry) ? MPI_THREAD_MULTIPLE : overlap ? MPI_THREAD_SERIALIZED : MPI_THREAD_FUNNELED;
+	int mpi_thread_provided;
+	MPI_Init_thread(&argc, &argv, mpi_thread_level, &mpi_thread_provided);
 
 	int mpi_rank, mpi_size;
 	int mpi_root = 0;
@@ -48,24 +58,71 @@ int main(int argc, char **argv)
 	if (mpi_rank == mpi_root)
 		cout << mpi_size << endl;
 
-	srand(time(NULL) + mpi_rank);
+	string inputName;
+	Options options;
+	parseArgs(argc, argv, inputName, options);
 
-	ifstream probfs, solfs;
-	int POPULATION_SIZE,
-		CHILD_PER_GNOME,
-		MAX_NUMBER_MUTATIONS,
-		NUMBER_GENERATIONS,
-		GEN_BATCH;
-	bool SYNC_BATCH;
-	parseArgs(argc, argv, probfs, solfs, POPULATION_SIZE, CHILD_PER_GNOME, MAX_NUMBER_MUTATIONS, NUMBER_GENERATIONS, GEN_BATCH, SYNC_BATCH);
+	if (options.OVERLAP && mpi_thread_provided < MPI_THREAD_SERIALIZED)
+	{
+		if (mpi_rank == mpi_root)
+			cerr << "Warning : MPI without thread support, synchronizations will not overlap" << endl;
+		options.OVERLAP = false;
+	}
+	if (options.OVERLAP && options.TELEMETRY_FILE != "" && mpi_thread_provided < MPI_THREAD_MULTIPLE)
+	{
+		if (mpi_rank == mpi_root)
+			cerr << "Warning : MPI without MPI_THREAD_MULTIPLE, synchronizations will not overlap the telemetry" << endl;
+		options.OVERLAP = false;
+	}
+
+	// Every node uses its own streams of the same seed, chosen by root if not given
+	if (!options.SEEDED)
+	{
+		options.SEED = time(NULL);
+		MPI_Bcast(&options.SEED, 1, MPI_UNSIGNED_LONG_LONG, mpi_root, MPI_COMM_WORLD);
+		if (mpi_rank == mpi_root)
+			cerr << "Seed : " << options.SEED << endl;
+	}
+
+	// The trace needs the timers of the profiler
+	if (!PROFILE && options.TRACE_FILE != "" && mpi_rank == mpi_root)
+		cerr << "Warning : --trace ignored, compile with make PROFILE=1" << endl;
+	init_profiler(options.TRACE_FILE);
+
+	// Every problem of a collection is solved by a single node or thread
+	if (batch)
+	{
+		if (mpi_thread_provided < MPI_THREAD_MULTIPLE && mpi_rank == mpi_root)
+			cerr << "Warning : MPI without MPI_THREAD_MULTIPLE, a single problem per node at a time" << endl;
+		if (options.TELEMETRY_FILE != "" && mpi_rank == mpi_root)
+			cerr << "Warning : --telemetry ignored in batch mode" << endl;
+
+		GenAlgBatch(options.BATCH_FILE, options, mpi_rank, mpi_size, mpi_root, mpi_thread_provided == MPI_THREAD_MULTIPLE, std::cout);
+
+		report_profile(mpi_rank, mpi_size, mpi_root);
+		MPI_Finalize();
+		return 0;
+	}
 
 	microseconds execution_time;
 	float best_fitness_sol;
+	GeneticBuffers buffers;
+
+	// The cache written by prepare already has the distances, neighbours and optimal cost of the problem
+	Map tsp;
+	bool cached = readCache(inputName, tsp);
+	if (!cached)
+		tsp = readProblem(inputName + ".tsp");
 
-	Map tsp = readProblem(probfs);
-	GenAlg(tsp, POPULATION_SIZE, NUMBER_GENERATIONS, CHILD_PER_GNOME, MAX_NUMBER_MUTATIONS, GEN_BATCH, mpi_rank, mpi_size, mpi_root, SYNC_BATCH, std::cout, best_fitness_sol, execution_time);
+	// Small problems are solved exactly, faster than the Genetic Algorithm
+	if (tsp.dimension <= options.EXACT)
+		HeldKarp(tsp, options, MPI_COMM_WORLD, mpi_root, std::cout, best_fitness_sol, execution_time);
+	else
+		GenAlg(tsp, options, MPI_COMM_WORLD, mpi_root, std::cout, best_fitness_sol, execution_time, buffers);
+	report_profile(mpi_rank, mpi_size, mpi_root);
 
-	readSolution(solfs, tsp);
+	if (!cached)
+		readSolution(inputName, tsp);
 
 	cout << "T-" << mpi_rank << "-"
 		 << "          " << execution_time.count() << endl;
@@ -80,6 +137,7 @@ int main(int argc, char **argv)
 			 << "          " << best_fitness_sol << endl;
 	}
 
+	closeCache(tsp);
 	MPI_Finalize();
 
 	return 0;
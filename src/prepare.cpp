@@ -0,0 +1,52 @@
+/**
+ * @file prepare.cpp
+ * @author Javier Vela
+ * @brief Preprocess a TSPLIB problem into the binary cache main loads at startup
+ * @version 0.1
+ * @date 2021-12-27
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#include <iostream>
+#include <string>
+#include "tsplib.h"
+#include "distance.h"
+#include "cache.h"
+
+using namespace std;
+
+/**
+ * @brief Parse <INPUT_FILE>.tsp, compute its distances and neighbours, read its optimal cost and write the cache
+ * <INPUT_FILE>.tspbin
+ */
+int main(int argc, char **argv)
+{
+	if (getFlag("-h", argc, argv))
+	{
+		cout << "-i <INPUT_FILE>"
+			 << endl
+			 << "--candidates <CANDIDATES>" << endl;
+		return 0;
+	}
+
+	string inputName = getParam("-i", argc, argv);
+	if (inputName == "")
+	{
+		cout << "Error : -i <INPUT_FILE> parameter not detected" << endl;
+		return -1;
+	}
+	string candidates = getParam("--candidates", argc, argv);
+
+	Map tsp = readProblem(inputName + ".tsp");
+	readSolution(inputName, tsp);
+	buildNeighbourCache(tsp, candidates == "" ? 8 : stoi(candidates));
+
+	if (!writeCache(inputName, tsp))
+	{
+		cout << "Error : " << inputName << CACHE_EXTENSION << " can not be written" << endl;
+		return -1;
+	}
+	return 0;
+}